@@ -0,0 +1,1481 @@
+/****************************************************************
+ * Non-interactive benchmark suite for the hash table engines.
+ *
+ * Sweeps table size, maximum load factor, hit/miss ratio and key
+ * distribution over every engine and reports, for each case:
+ *   - insert and lookup throughput (million operations per second)
+ *   - p50/p99/p999 lookup latency in nanoseconds
+ *   - bytes per entry and the achieved load factor
+ *   - the chain length distribution (chained engines)
+ * The engines are chained (HashMap, DJBX33A % size), slab (the same
+ * on a SlabPool), numeric (NumericIDHash & mask), wyhash (WyHash
+ * with fastrange), flat (FlatHashMap) and compact.
+ * Results go to stdout as a table and optionally to CSV and JSON
+ * files so runs of different versions can be diffed.
+ *
+ * Sizes whose estimated memory would not fit in physical memory
+ * are skipped with a note rather than swapping the machine to death.
+ *
+ * The single reports measure one engine on generated students
+ * (StudentGenerator, --seed) and exit instead of running the sweep:
+ *   --compare N    HashMap and FlatHashMap on the same N IDs
+ *   --footprint N  bytes per student of every storage mode, counted
+ *                  from the tables and measured from the RSS
+ *   --alloc N      load time, teardown time and RSS of each node
+ *                  allocator
+ *   --batch N      single against batched inserts and lookups
+ *   --generate N   students generated per second
+ *   --hash-quality N  chi-square and longest chain of every hash
+ *                  and range policy pair
+ *   --stats N      the table's stats after N puts and N lookups
+ *   --snapshot-bench FILE N  saving, opening, verifying and looking
+ *                  up an N student snapshot FILE
+ *   --import-bench FILE N  writing N students to FILE (CSV if it ends
+ *                  in .csv) and importing them
+ *   --index N      range and top-K queries with and without indexes
+ *   --columns N    aggregates by row walk and by column scans
+ *   --scaling T    ConcurrentHashMap throughput from 1 to T threads
+ *   --sharded T    ShardedHashMap with 1 to T shards next to
+ *                  ConcurrentHashMap with as many threads
+ *   --load PATH N  put, get, check and delete N students through
+ *                  the server at PATH, --depth D requests a write
+ *   --export-bench N  display() and exporting N students in every
+ *                  format, on 1 thread and on every core
+ *   --freeze N     freezing N students into a FrozenHashMap, and its
+ *                  lookups and bytes per student next to HashMap's
+ *   --filter-bench N  hits and misses on N students with Bloom
+ *                  filters of a few false positive rates on and off
+ *
+ * Build with: make benchmark
+ ****************************************************************/
+
+#include <cstdio>       // report output
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>       // throughput and latency timing
+#include <algorithm>    // percentiles
+#include <random>       // seeded key order
+#include <sstream>      // comma separated option lists
+#include <thread>       // worker threads for the throughput reports
+#include <atomic>       // start flag for the throughput reports
+#include <charconv>     // GPAs of the load generator's PUT requests
+#include <cstring>      // strlen
+#include <fstream>      // /dev/null sink for the display() baseline
+#include <type_traits>  // std::is_same for the allocator report
+#include <fcntl.h>      // open /dev/null for the export report
+#include <unistd.h>     // close
+#include "student.h"    // Student records and StudentMap
+#include "flathashmap.h"    // generic open addressing engine
+#include "compactstudent.h" // packed records with pooled names
+#include "concurrentmap.h"  // thread safe table with lock-free reads
+#include "shardedmap.h"  // shared-nothing shards driven through message queues
+#include "generator.h"  // seeded synthetic students for the single reports
+#include "server.h"     // the client the load generator drives a server with
+#include "exporter.h"   // parallel CSV/JSON/binary dumps
+#include "frozenmap.h"  // read-only tables over a minimal perfect hash
+#include "bloomfilter.h"    // tables with a Bloom filter in front of lookups
+#include "snapshot.h"   // memory mapped snapshot files
+#include "importer.h"   // parallel CSV/binary bulk loads
+#include "studentindex.h"   // age and GPA range queries
+#include "columnar.h"   // struct of arrays age/GPA shadow and its scan kernels
+#include "rss.h"        // physical memory for the size guard
+
+#define CHAIN_BUCKETS STATS_CHAIN_BUCKETS  // chain length histogram: 0 through 7 and 8 or more
+#define LATENCY_SAMPLES 200000  // lookups timed one by one for the percentiles
+#define TABLE_SIZE 97   // starting size of the single reports' tables, they grow from there
+
+using std::vector;
+using std::chrono::steady_clock;
+
+using FlatStudentMap = FlatHashMap<string, Student, StringHash, StringEq>;
+using ConcurrentStudentMap = ConcurrentHashMap<string, Student, StringHash, StringEq>;
+using ShardedStudentMap = ShardedHashMap<string, Student, StringHash, StringEq>;
+using FrozenStudentMap = FrozenHashMap<string, Student, WyHash, StringEq>;
+using FilteredStudentMap = FilteredHashMap<string, Student, StringHash, StringEq>;
+
+static StudentGenerator generator;                          // every student and ID of the single reports (--seed)
+
+/*
+ * One benchmark case and what was measured for it
+ */
+struct Result {
+    string engine;                                          // engine name
+    string distribution;                                    // key distribution
+    unsigned long size;                                     // number of entries inserted
+    double maxLoadFactor;                                   // growth threshold (chained engines only, else 0)
+    double hitRatio;                                        // fraction of lookups for present keys
+    double loadFactor;                                      // achieved entries per bucket/slot
+    double insertMops;                                      // million inserts per second
+    double lookupMops;                                      // million lookups per second
+    double p50;                                             // lookup latency percentiles in nanoseconds
+    double p99;
+    double p999;
+    double bytesPerEntry;                                   // table memory divided by size
+    unsigned long chains[CHAIN_BUCKETS];                    // buckets holding 0..7 and 8+ entries
+    unsigned long maxChain;                                 // longest chain (0 for open addressing)
+};
+
+/*
+ * Benchmark configuration from the command line
+ */
+struct Options {
+    vector<unsigned long> sizes{1000, 10000, 100000, 1000000, 10000000, 100000000};
+    vector<double> loadFactors{0.5, 1.0, 2.0, 4.0};
+    vector<double> hitRatios{1.0, 0.5, 0.0};
+    vector<string> distributions{"uniform", "sequential", "clustered"};
+    vector<string> engines{"chained", "slab", "numeric", "wyhash", "flat", "compact"};
+    unsigned long maxLookups = 1000000;                     // lookups per case (fewer for small tables)
+    unsigned long seed = 42;
+    string csv;                                             // CSV output path (empty for none)
+    string json;                                            // JSON output path (empty for none)
+    string report;                                          // a single report to run instead of the sweep (empty for none)
+    unsigned long reportSize = 0;                           // its N or T
+    string reportPath;                                      // the server --load drives, or the file a report writes
+    unsigned int depth = 128;                               // requests --load sends per write
+};
+
+/***************************
+ * Static methods to be used
+ ***************************/
+static uint64_t makeID(const string& distribution, unsigned long i);   // i-th ID of a distribution (unique per i)
+static void makeKeys(const string& distribution, unsigned long n,
+                     vector<string>& present, vector<string>& absent);  // n inserted IDs and n IDs never inserted
+template <class Engine>
+static Result runCase(Engine& engine, const Options& opt, const vector<string>& present,
+                      const vector<string>& absent, double hitRatio);   // load one engine and measure it
+static bool runEngine(const string& name, const Options& opt, const string& distribution,
+                      const vector<string>& present, const vector<string>& absent,
+                      vector<Result>& results, double& bytesPerEntry);  // every load factor/hit ratio for one engine
+static void printResult(const Result& r);                   // one line of the stdout table
+static void writeCSV(const string& path, const vector<Result>& results);
+static void writeJSON(const string& path, const vector<Result>& results);
+static bool parseOptions(int argc, char *argv[], Options& opt);
+static void runReport(const Options& opt);                  // the single report opt.report names
+static double mops(unsigned long n, steady_clock::time_point start,
+                   steady_clock::time_point stop);          // millions of operations per second
+static void compareEngines(unsigned long n);                // time HashMap and FlatHashMap on the same IDs
+static void reportFootprint(unsigned long n);               // memory per student of every storage mode
+static void reportAllocators(unsigned long n);              // load/teardown time and RSS of each node allocator
+static void reportBatching(unsigned long n);                // single vs batched insert and lookup throughput
+static void reportGenerator(unsigned long n);               // students generated per second on 1 thread and every core
+static void reportHashQuality(unsigned long n);             // bucket spread of every hash and range policy on n IDs
+static void reportStats(unsigned long n);                   // HashMap stats after loading and querying n students
+static void reportSnapshot(const string& path, unsigned long n);    // save/open/lookup times of an n student snapshot
+static void reportImport(const string& path, unsigned long n);  // write n students to a file and time importing it
+static void reportIndexes(unsigned long n);                 // indexed vs full walk range queries on n students
+static void reportColumns(unsigned long n);                 // row walk vs scalar and SIMD column scans on n students
+static double runMixed(ConcurrentStudentMap& table, const vector<string>& ids, unsigned int threads,
+                       unsigned int readPercent, unsigned long opsPerThread);  // operations per second of a mix
+static void reportScaling(unsigned int maxThreads);         // concurrent throughput from 1 to maxThreads threads
+static void reportSharding(unsigned int maxShards);         // sharded vs lock-based throughput from 1 to maxShards
+static void reportServerLoad(const string& socketPath, unsigned long n,
+                             unsigned int depth);           // drive a running server with n pipelined requests a phase
+static void reportExport(unsigned long n);                  // display() vs exporting n students in every format
+static void reportFrozen(unsigned long n);                  // freeze n students, lookups and bytes/key vs HashMap
+static void reportFilter(unsigned long n);                  // hit/miss latency with and without a Bloom filter
+
+/*******************
+ * MAIN METHOD BEGIN
+ *******************/
+int main(int argc, char *argv[]) {
+    Options opt;
+    if(!parseOptions(argc, argv, opt)){
+        printf("usage: %s [--sizes N,N,...] [--load-factors F,F,...] [--hit-ratios R,R,...]\n"
+               "          [--distributions uniform,sequential,clustered]\n"
+               "          [--engines chained,slab,numeric,wyhash,flat,compact]\n"
+               "          [--lookups N] [--seed S] [--csv FILE] [--json FILE]\n"
+               "       %s [--seed S] --compare N | --footprint N | --alloc N | --batch N | --generate N\n"
+               "          | --hash-quality N | --stats N | --snapshot-bench FILE N | --import-bench FILE N\n"
+               "          | --index N | --columns N | --scaling T | --sharded T | [--depth D] --load PATH N\n"
+               "          | --export-bench N | --freeze N | --filter-bench N\n", argv[0], argv[0]);
+        return 1;
+    }
+    generator.reseed(opt.seed);
+    if(!opt.report.empty()){
+        runReport(opt);
+        return 0;
+    }
+
+    vector<Result> results;
+    vector<double> bytesPerEntry(opt.engines.size(), 200.0);    // refined after every measured size
+    const double available = physicalBytes() * 0.8;
+    printf("%-8s %-10s %10s %5s %4s %6s %9s %9s %8s %8s %8s %8s %6s\n", "engine", "keys", "size", "maxlf", "hit",
+           "lf", "ins Mop/s", "get Mop/s", "p50 ns", "p99 ns", "p999 ns", "B/entry", "chain");
+    for(const string& distribution : opt.distributions){
+        for(unsigned long size : opt.sizes){
+            vector<string> present;
+            vector<string> absent;
+            for(unsigned long e = 0; e < opt.engines.size(); e++){
+                double needed = size * (bytesPerEntry[e] * 1.5 + 2 * sizeof(string));  // table plus both key lists
+                if(needed > available){
+                    printf("%-8s %-10s %10lu skipped, needs about %.1f GB\n", opt.engines[e].c_str(),
+                           distribution.c_str(), size, needed / 1e9);
+                    continue;
+                }
+                if(present.empty()){
+                    makeKeys(distribution, size, present, absent);
+                }
+                if(!runEngine(opt.engines[e], opt, distribution, present, absent, results, bytesPerEntry[e])){
+                    printf("unknown engine %s\n", opt.engines[e].c_str());
+                    return 1;
+                }
+            }
+        }
+    }
+
+    if(!opt.csv.empty()){
+        writeCSV(opt.csv, results);
+    }
+    if(!opt.json.empty()){
+        writeJSON(opt.json, results);
+    }
+    return 0;
+}
+/*****************
+ * MAIN METHOD END
+ *****************/
+
+/*
+ * Engine adapters: each one owns a table and exposes the same
+ * insert/find/measurement calls so runCase() can drive any of them.
+ */
+template <class Pool, class Hash = StringHash, class Range = ModuloRange>
+struct ChainedEngine {
+    HashMap<string, Student, Hash, StringEq, Pool, Range> table;
+    explicit ChainedEngine(double maxLoadFactor) : table(97, maxLoadFactor) {}
+    void insert(const string& id){ this->table.put(id, Student("Rusty Dillard", id, 20, 3.5)); }
+    bool find(const string& id){ return this->table.find(id) != nullptr; }
+    double loadFactor() const{ return this->table.getLoadFactor(); }
+    unsigned long memoryUsage() const{ return this->table.memoryUsage(); }
+    unsigned long chains(unsigned long *histogram){          // fills the histogram, returns the longest chain
+        this->table.finishRehash();                         // measure the chains of the current table only
+        HashMapStats s = this->table.stats();
+        for(int i = 0; i < CHAIN_BUCKETS; i++){
+            histogram[i] = s.chains[i];
+        }
+        return s.maxChain;
+    }
+};
+
+struct FlatEngine {
+    FlatStudentMap table{97};
+    void insert(const string& id){ this->table.put(id, Student("Rusty Dillard", id, 20, 3.5)); }
+    bool find(const string& id){ return this->table.find(id) != nullptr; }
+    double loadFactor() const{ return this->table.getLoadFactor(); }
+    unsigned long memoryUsage() const{ return this->table.memoryUsage(); }
+    unsigned long chains(unsigned long *){ return 0; }     // open addressing has no chains
+};
+
+struct CompactEngine {
+    CompactStudentTable table{97};
+    void insert(const string& id){ this->table.put("Rusty Dillard", id, 20, 3.5); }
+    bool find(const string& id){ return this->table.find(id) != nullptr; }
+    double loadFactor() const{ return static_cast<double>(this->table.getCount()) / this->table.getSize(); }
+    unsigned long memoryUsage() const{ return this->table.memoryUsage(); }
+    unsigned long chains(unsigned long *){ return 0; }
+};
+
+// The i-th ID of a distribution; different i always give different IDs (for i < 10^9)
+static uint64_t makeID(const string& distribution, unsigned long i){
+    const uint64_t base = 9000000000ULL;                    // every ID starts with a 9, like genID()
+    if(distribution == "sequential"){                       // consecutive enrollment numbers
+        return base + i;
+    }
+    if(distribution == "clustered"){                        // dense runs of 1000 scattered over the ID space
+        uint64_t cluster = (i / 1000 * 7919ULL + 12345) % 1000000ULL;   // 7919 is coprime to 10^6, so no repeats
+        return base + cluster * 1000 + i % 1000;
+    }
+    return base + (i * 387420489ULL + 2718281ULL) % 1000000000ULL;     // uniform: a permutation of 0..10^9-1
+}
+
+// Fill present with the n IDs to insert and absent with n more from the same distribution that never are
+static void makeKeys(const string& distribution, unsigned long n, vector<string>& present, vector<string>& absent){
+    present.resize(n);
+    absent.resize(n);
+    for(unsigned long i = 0; i < n; i++){
+        present[i] = formatID(makeID(distribution, 2 * i));
+        absent[i] = formatID(makeID(distribution, 2 * i + 1));
+    }
+}
+
+// Value at fraction p of an unsorted sample
+static double percentile(vector<double>& sample, double p){
+    auto k = static_cast<std::ptrdiff_t>(p * (sample.size() - 1));
+    std::nth_element(sample.begin(), sample.begin() + k, sample.end());
+    return sample[k];
+}
+
+// Load present into the engine, then measure lookups where hitRatio of them are for present keys
+template <class Engine>
+static Result runCase(Engine& engine, const Options& opt, const vector<string>& present,
+                      const vector<string>& absent, double hitRatio){
+    Result r{};
+    unsigned long n = present.size();
+    std::mt19937_64 rng(opt.seed);
+
+    auto start = steady_clock::now();
+    for(const string& id : present){
+        engine.insert(id);
+    }
+    auto stop = steady_clock::now();
+    r.insertMops = n / std::chrono::duration<double, std::micro>(stop - start).count();
+
+    // lookups in random order so the cache sees the same access pattern at every size
+    unsigned long lookups = n > opt.maxLookups ? opt.maxLookups : (n < 100000 ? 100000 : n);
+    vector<const string *> queries(lookups);
+    for(unsigned long i = 0; i < lookups; i++){
+        bool hit = static_cast<double>(rng() % 1000000) < hitRatio * 1000000;
+        queries[i] = hit ? &present[rng() % n] : &absent[rng() % n];
+    }
+    unsigned long found = 0;
+    start = steady_clock::now();
+    for(const string *id : queries){
+        found += engine.find(*id);
+    }
+    stop = steady_clock::now();
+    r.lookupMops = lookups / std::chrono::duration<double, std::micro>(stop - start).count();
+
+    // time a sample of lookups one by one, less what the clock itself costs
+    vector<double> overhead(1000);
+    for(double& o : overhead){
+        auto a = steady_clock::now();
+        o = std::chrono::duration<double, std::nano>(steady_clock::now() - a).count();
+    }
+    double clock = percentile(overhead, 0.5);
+    unsigned long samples = lookups < LATENCY_SAMPLES ? lookups : LATENCY_SAMPLES;
+    vector<double> latency(samples);
+    for(unsigned long i = 0; i < samples; i++){
+        auto a = steady_clock::now();
+        found += engine.find(*queries[i]);
+        double ns = std::chrono::duration<double, std::nano>(steady_clock::now() - a).count() - clock;
+        latency[i] = ns > 0 ? ns : 0;
+    }
+    r.p50 = percentile(latency, 0.5);
+    r.p99 = percentile(latency, 0.99);
+    r.p999 = percentile(latency, 0.999);
+    if(found == ~0UL){                                      // keep the lookups from being optimized away
+        printf("?");
+    }
+
+    r.size = n;
+    r.hitRatio = hitRatio;
+    r.loadFactor = engine.loadFactor();
+    r.bytesPerEntry = static_cast<double>(engine.memoryUsage()) / n;
+    r.maxChain = engine.chains(r.chains);
+    return r;
+}
+
+// Run every load factor and hit ratio of one engine, returns false for an unknown engine name
+static bool runEngine(const string& name, const Options& opt, const string& distribution,
+                      const vector<string>& present, const vector<string>& absent,
+                      vector<Result>& results, double& bytesPerEntry){
+    bool chained = name == "chained" || name == "slab" || name == "numeric" || name == "wyhash";
+    if(!chained && name != "flat" && name != "compact"){
+        return false;
+    }
+    // the load factor only steers the chained engines, the others always run at their own fixed maximum
+    vector<double> loadFactors = chained ? opt.loadFactors : vector<double>{0.0};
+    for(double lf : loadFactors){
+        for(double hit : opt.hitRatios){
+            Result r;
+            if(name == "chained"){
+                ChainedEngine<HeapPool> engine(lf);
+                r = runCase(engine, opt, present, absent, hit);
+            }
+            else if(name == "slab"){
+                ChainedEngine<SlabPool> engine(lf);
+                r = runCase(engine, opt, present, absent, hit);
+            }
+            else if(name == "numeric"){
+                ChainedEngine<HeapPool, NumericIDHash, MaskRange> engine(lf);
+                r = runCase(engine, opt, present, absent, hit);
+            }
+            else if(name == "wyhash"){
+                ChainedEngine<HeapPool, WyHash, FastRange> engine(lf);
+                r = runCase(engine, opt, present, absent, hit);
+            }
+            else if(name == "flat"){
+                FlatEngine engine;
+                r = runCase(engine, opt, present, absent, hit);
+            }
+            else{
+                CompactEngine engine;
+                r = runCase(engine, opt, present, absent, hit);
+            }
+            r.engine = name;
+            r.distribution = distribution;
+            r.maxLoadFactor = lf;
+            bytesPerEntry = r.bytesPerEntry;
+            printResult(r);
+            results.push_back(r);
+        }
+    }
+    return true;
+}
+
+// One line of the stdout table
+static void printResult(const Result& r){
+    printf("%-8s %-10s %10lu %5.2g %4.2g %6.2f %9.2f %9.2f %8.0f %8.0f %8.0f %8.1f %6lu\n", r.engine.c_str(),
+           r.distribution.c_str(), r.size, r.maxLoadFactor, r.hitRatio, r.loadFactor, r.insertMops, r.lookupMops,
+           r.p50, r.p99, r.p999, r.bytesPerEntry, r.maxChain);
+    fflush(stdout);
+}
+
+// Write every result as one CSV row
+static void writeCSV(const string& path, const vector<Result>& results){
+    FILE *f = fopen(path.c_str(), "w");
+    if(f == nullptr){
+        perror(path.c_str());
+        return;
+    }
+    fprintf(f, "engine,distribution,size,max_load_factor,hit_ratio,load_factor,insert_mops,lookup_mops,"
+               "p50_ns,p99_ns,p999_ns,bytes_per_entry,max_chain");
+    for(int i = 0; i < CHAIN_BUCKETS; i++){
+        fprintf(f, i + 1 < CHAIN_BUCKETS ? ",chains_%d" : ",chains_%d_plus", i);
+    }
+    fprintf(f, "\n");
+    for(const Result& r : results){
+        fprintf(f, "%s,%s,%lu,%g,%g,%.4f,%.4f,%.4f,%.1f,%.1f,%.1f,%.2f,%lu", r.engine.c_str(),
+                r.distribution.c_str(), r.size, r.maxLoadFactor, r.hitRatio, r.loadFactor, r.insertMops,
+                r.lookupMops, r.p50, r.p99, r.p999, r.bytesPerEntry, r.maxChain);
+        for(unsigned long c : r.chains){
+            fprintf(f, ",%lu", c);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+// Write every result as an element of a JSON array
+static void writeJSON(const string& path, const vector<Result>& results){
+    FILE *f = fopen(path.c_str(), "w");
+    if(f == nullptr){
+        perror(path.c_str());
+        return;
+    }
+    fprintf(f, "[\n");
+    for(unsigned long i = 0; i < results.size(); i++){
+        const Result& r = results[i];
+        fprintf(f, "  {\"engine\": \"%s\", \"distribution\": \"%s\", \"size\": %lu, \"max_load_factor\": %g, "
+                   "\"hit_ratio\": %g, \"load_factor\": %.4f, \"insert_mops\": %.4f, \"lookup_mops\": %.4f, "
+                   "\"p50_ns\": %.1f, \"p99_ns\": %.1f, \"p999_ns\": %.1f, \"bytes_per_entry\": %.2f, "
+                   "\"max_chain\": %lu, \"chains\": [", r.engine.c_str(), r.distribution.c_str(), r.size,
+                r.maxLoadFactor, r.hitRatio, r.loadFactor, r.insertMops, r.lookupMops, r.p50, r.p99, r.p999,
+                r.bytesPerEntry, r.maxChain);
+        for(int c = 0; c < CHAIN_BUCKETS; c++){
+            fprintf(f, c > 0 ? ", %lu" : "%lu", r.chains[c]);
+        }
+        fprintf(f, i + 1 < results.size() ? "]},\n" : "]}\n");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+}
+
+// Split a comma separated option value
+static vector<string> splitList(const string& s){
+    vector<string> items;
+    std::stringstream stream(s);
+    string item;
+    while(getline(stream, item, ',')){
+        if(!item.empty()){
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Read the command line into opt, returns false on anything unrecognized
+static bool parseOptions(int argc, char *argv[], Options& opt){
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(i + 1 >= argc){
+            return false;                                   // every option takes a value
+        }
+        string value = argv[++i];
+        if(arg == "--sizes"){
+            opt.sizes.clear();
+            for(const string& s : splitList(value)){
+                opt.sizes.push_back(std::stoul(s));
+            }
+        }
+        else if(arg == "--load-factors"){
+            opt.loadFactors.clear();
+            for(const string& s : splitList(value)){
+                opt.loadFactors.push_back(std::stod(s));
+            }
+        }
+        else if(arg == "--hit-ratios"){
+            opt.hitRatios.clear();
+            for(const string& s : splitList(value)){
+                opt.hitRatios.push_back(std::stod(s));
+            }
+        }
+        else if(arg == "--distributions"){
+            opt.distributions = splitList(value);
+        }
+        else if(arg == "--engines"){
+            opt.engines = splitList(value);
+        }
+        else if(arg == "--lookups"){
+            opt.maxLookups = std::stoul(value);
+        }
+        else if(arg == "--seed"){
+            opt.seed = std::stoul(value);
+        }
+        else if(arg == "--csv"){
+            opt.csv = value;
+        }
+        else if(arg == "--json"){
+            opt.json = value;
+        }
+        else if(arg == "--compare" || arg == "--footprint" || arg == "--alloc" || arg == "--batch" ||
+                arg == "--generate" || arg == "--hash-quality" || arg == "--stats" || arg == "--index" ||
+                arg == "--columns" || arg == "--scaling" || arg == "--sharded" || arg == "--export-bench" ||
+                arg == "--freeze" || arg == "--filter-bench"){
+            opt.report = arg.substr(2);
+            opt.reportSize = std::stoul(value);
+        }
+        else if((arg == "--load" || arg == "--snapshot-bench" || arg == "--import-bench") && i + 1 < argc){
+            opt.report = arg.substr(2);                     // the options with two values, PATH N
+            opt.reportPath = value;
+            opt.reportSize = std::stoul(argv[++i]);
+        }
+        else if(arg == "--depth"){
+            opt.depth = std::stoul(value);
+        }
+        else{
+            return false;
+        }
+    }
+    return true;
+}
+
+// Run the single report opt.report names
+static void runReport(const Options& opt){
+    if(opt.report == "compare"){
+        compareEngines(opt.reportSize);
+    }
+    else if(opt.report == "footprint"){
+        reportFootprint(opt.reportSize);
+    }
+    else if(opt.report == "alloc"){
+        reportAllocators(opt.reportSize);
+    }
+    else if(opt.report == "batch"){
+        reportBatching(opt.reportSize);
+    }
+    else if(opt.report == "generate"){
+        reportGenerator(opt.reportSize);
+    }
+    else if(opt.report == "hash-quality"){
+        reportHashQuality(opt.reportSize);
+    }
+    else if(opt.report == "stats"){
+        reportStats(opt.reportSize);
+    }
+    else if(opt.report == "snapshot-bench"){
+        reportSnapshot(opt.reportPath, opt.reportSize);
+    }
+    else if(opt.report == "import-bench"){
+        reportImport(opt.reportPath, opt.reportSize);
+    }
+    else if(opt.report == "index"){
+        reportIndexes(opt.reportSize);
+    }
+    else if(opt.report == "columns"){
+        reportColumns(opt.reportSize);
+    }
+    else if(opt.report == "scaling"){
+        reportScaling(opt.reportSize);
+    }
+    else if(opt.report == "sharded"){
+        reportSharding(opt.reportSize);
+    }
+    else if(opt.report == "load"){
+        reportServerLoad(opt.reportPath, opt.reportSize, opt.depth);
+    }
+    else if(opt.report == "export-bench"){
+        reportExport(opt.reportSize);
+    }
+    else if(opt.report == "freeze"){
+        reportFrozen(opt.reportSize);
+    }
+    else if(opt.report == "filter-bench"){
+        reportFilter(opt.reportSize);
+    }
+}
+
+// Millions of operations per second for n operations over a steady_clock interval
+static double mops(unsigned long n, steady_clock::time_point start, steady_clock::time_point stop){
+    return n / std::chrono::duration<double, std::micro>(stop - start).count();
+}
+
+// Time n inserts, n successful lookups and n failed lookups on one engine
+template <class Table>
+static void timeEngine(const char *name, const vector<string>& ids, const vector<string>& missing){
+    using std::chrono::duration;
+    Table table(TABLE_SIZE);
+    
+    auto start = steady_clock::now();
+    for(const string& id : ids){
+        table.put(id, Student("x", id, 18, 4.0));
+    }
+    auto inserted = steady_clock::now();
+    unsigned long found = 0;
+    for(const string& id : ids){
+        found += table.find(id) != nullptr;
+    }
+    auto hit = steady_clock::now();
+    for(const string& id : missing){
+        found += table.find(id) != nullptr;
+    }
+    auto miss = steady_clock::now();
+    
+    double n = static_cast<double>(ids.size());
+    printf("%-12s insert %8.1f ns/op | hit %8.1f ns/op | miss %8.1f ns/op | found %lu of %lu\n", name,
+           duration<double, std::nano>(inserted - start).count() / n,
+           duration<double, std::nano>(hit - inserted).count() / n,
+           duration<double, std::nano>(miss - hit).count() / n,
+           found, ids.size());
+}
+
+// Run the same ID workload through both engines
+static void compareEngines(unsigned long n){
+    vector<string> ids;
+    vector<string> missing;
+    generator.generateIDs(n, ids);
+    generator.generateIDs(n, missing);
+    for(string& miss : missing){
+        miss[0] = '8';                          // generated IDs all start with 9, so this one can't be present
+    }
+    printf("%lu students, control group width %d\n", n, GROUP_WIDTH);
+    timeEngine<StudentMap>("HashMap", ids, missing);
+    timeEngine<FlatStudentMap>("FlatHashMap", ids, missing);
+}
+
+// Heap bytes owned by a string beyond the string object itself
+static unsigned long stringHeap(const string& s){
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;   // shorter strings fit the small string buffer
+}
+
+// Print one footprint line and return the measured bytes per student
+static double printFootprint(const char *name, unsigned long n, unsigned long counted, unsigned long rss){
+    printf("%-20s %8.1f bytes/student counted | %8.1f bytes/student RSS\n", name,
+           static_cast<double>(counted) / n, static_cast<double>(rss) / n);
+    return static_cast<double>(rss) / n;
+}
+
+// Load the same n students into every storage mode and report what each one costs
+static void reportFootprint(unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    printf("%lu students\n", n);
+    
+    double full;
+    double compact;
+    unsigned long fullCounted;
+    unsigned long compactCounted;
+    
+    // the compact table goes first, before the bigger tables have had a chance to fragment the heap
+    {
+        trimHeap();
+        unsigned long before = residentBytes();
+        CompactStudentTable table(TABLE_SIZE);
+        for(const Student& s : students){
+            table.put(s.getName(), s.getID(), s.getAge(), s.getGPA());
+        }
+        compactCounted = table.memoryUsage();
+        compact = printFootprint("CompactStudentTable", n, compactCounted, residentBytes() - before);
+    }
+    {
+        trimHeap();
+        unsigned long before = residentBytes();
+        StudentMap table(TABLE_SIZE);
+        for(const Student& s : students){
+            table.put(s.getID(), s);
+        }
+        unsigned long counted = table.memoryUsage();
+        table.forEach([&counted](const string& key, const Student& s){
+            counted += stringHeap(key) + stringHeap(s.getName()) + stringHeap(s.getID());
+        });
+        fullCounted = counted;
+        full = printFootprint("HashMap", n, counted, residentBytes() - before);
+    }
+    {
+        trimHeap();
+        unsigned long before = residentBytes();
+        FlatStudentMap table(TABLE_SIZE);
+        for(const Student& s : students){
+            table.put(s.getID(), s);
+        }
+        unsigned long counted = table.memoryUsage();
+        table.forEach([&counted](const string& key, const Student& s){
+            counted += stringHeap(key) + stringHeap(s.getName()) + stringHeap(s.getID());
+        });
+        printFootprint("FlatHashMap", n, counted, residentBytes() - before);
+    }
+    printf("compact mode uses %.1fx less memory than HashMap counted, %.1fx by RSS\n",
+           static_cast<double>(fullCounted) / compactCounted, full / compact);
+}
+
+// Load n students into a chained table using one node allocator, then destroy it, timing both
+template <class Table>
+static void timeAllocator(const char *name, const vector<Student>& students, bool hugePages){
+    using std::chrono::duration;
+    trimHeap();
+    unsigned long before = residentBytes();
+    
+    auto *table = new Table(TABLE_SIZE);
+    if constexpr (std::is_same<Table, SlabStudentMap>::value){
+        table->getPool().setHugePages(hugePages);   // only slabs can be backed by huge pages
+    }
+    auto start = steady_clock::now();
+    for(const Student& s : students){
+        table->put(s.getID(), s);
+    }
+    auto loaded = steady_clock::now();
+    unsigned long rss = residentBytes() - before;
+    delete table;
+    auto destroyed = steady_clock::now();
+    
+    double n = static_cast<double>(students.size());
+    printf("%-18s load %8.1f ns/student | teardown %8.1f ns/student | RSS %8.1f bytes/student\n", name,
+           duration<double, std::nano>(loaded - start).count() / n,
+           duration<double, std::nano>(destroyed - loaded).count() / n,
+           static_cast<double>(rss) / n);
+}
+
+// Compare plain heap nodes against slab allocated nodes on the same students
+static void reportAllocators(unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    printf("%lu students\n", n);
+    timeAllocator<StudentMap>("HeapPool", students, false);
+    timeAllocator<SlabStudentMap>("SlabPool", students, false);
+    timeAllocator<SlabStudentMap>("SlabPool hugepages", students, true);
+}
+
+// Insert and look up n generated IDs one at a time and in batches, on tables far larger than the cache
+static void reportBatching(unsigned long n){
+    using IDMap = HashMap<string, unsigned int, StringHash, StringEq, SlabPool>;
+    const unsigned long batch = 1024;                       // keys handed to each insertBatch/findBatch call
+    
+    vector<string> ids;
+    vector<string> missing;
+    generator.generateIDs(n, ids);
+    generator.generateIDs(n / 2, missing);                  // never inserted, so every one of these misses
+    std::mt19937_64 rng(generator.getSeed());               // hit order follows --seed too
+    vector<string> lookups(n);
+    for(unsigned long i = 0; i < n; i++){                   // half hits in random order, half misses
+        lookups[i] = i % 2 == 0 ? ids[rng() % n] : missing[i / 2];
+    }
+    printf("%lu keys, batches of %lu\n", n, batch);
+    
+    vector<string> keys(ids);                               // insertBatch moves out of its arrays
+    vector<unsigned int> values(n);
+    IDMap single(TABLE_SIZE);
+    IDMap batched(TABLE_SIZE);
+    auto start = steady_clock::now();
+    for(unsigned long i = 0; i < n; i++){
+        single.put(ids[i], i);
+    }
+    auto mid = steady_clock::now();
+    for(unsigned long i = 0; i < n; i += batch){
+        unsigned long w = n - i < batch ? n - i : batch;
+        for(unsigned long j = 0; j < w; j++){
+            values[i + j] = i + j;
+        }
+        batched.insertBatch(&keys[i], &values[i], w);
+    }
+    auto stop = steady_clock::now();
+    printf("insert  single %7.2f Mops/s | batched %7.2f Mops/s\n", mops(n, start, mid), mops(n, mid, stop));
+    
+    unsigned long found = 0;
+    vector<unsigned int *> out(batch);
+    start = steady_clock::now();
+    for(unsigned long i = 0; i < n; i++){
+        found += single.find(lookups[i]) != nullptr;
+    }
+    mid = steady_clock::now();
+    for(unsigned long i = 0; i < n; i += batch){
+        unsigned long w = n - i < batch ? n - i : batch;
+        batched.findBatch(&lookups[i], w, out.data());
+        for(unsigned long j = 0; j < w; j++){
+            found += out[j] != nullptr;
+        }
+    }
+    stop = steady_clock::now();
+    printf("lookup  single %7.2f Mops/s | batched %7.2f Mops/s | %lu hits\n",
+           mops(n, start, mid), mops(n, mid, stop), found);
+}
+
+// Generate n students on one thread and then on every core
+static void reportGenerator(unsigned long n){
+    unsigned int cores = std::thread::hardware_concurrency();
+    uint64_t seed = generator.getSeed();                    // each run starts over from the --seed population
+    printf("%lu students\n", n);
+    for(unsigned int threads : {1U, cores}){
+        vector<Student> students;
+        students.reserve(n);
+        generator.reseed(seed);
+        auto start = steady_clock::now();
+        generator.generate(n, students, threads);
+        auto stop = steady_clock::now();
+        printf("%2u threads %8.2f M students/s\n", threads, mops(n, start, stop));
+        if(cores <= 1){
+            break;
+        }
+    }
+}
+
+// Spread one hash/range pair over a table sized the way HashMap would size it for ids
+template <class Hash, class Range>
+static void hashQuality(const char *name, const vector<string>& ids){
+    unsigned long size = Range::fit(TABLE_SIZE);
+    while(ids.size() > size){                               // where the default load factor of 1 stops growing
+        size = Range::grow(size);
+    }
+    vector<unsigned long> buckets(size);
+    Hash hash;
+    auto start = steady_clock::now();
+    for(const string& id : ids){
+        buckets[Range::bucket(hash(id), size)]++;
+    }
+    auto stop = steady_clock::now();
+    
+    // chi-square over the buckets, divided by its degrees of freedom so a uniform spread scores about 1.0
+    double expected = static_cast<double>(ids.size()) / size;
+    double chi = 0;
+    unsigned long longest = 0;
+    for(unsigned long c : buckets){
+        chi += (c - expected) * (c - expected) / expected;
+        longest = c > longest ? c : longest;
+    }
+    printf("  %-22s %10lu buckets | chi2/df %10.3f | longest chain %6lu | %6.2f ns/key\n", name, size,
+           chi / (size > 1 ? size - 1 : 1), longest,
+           std::chrono::duration<double, std::nano>(stop - start).count() / ids.size());
+}
+
+// Every hash policy with every range policy, on generated, sequential and clustered IDs
+static void reportHashQuality(unsigned long n){
+    vector<string> generated;
+    vector<string> sequential;
+    vector<string> clustered;
+    generator.generateIDs(n, generated);
+    for(unsigned long i = 0; i < n; i++){
+        sequential.push_back(formatID(9000000000ULL + i));  // consecutive enrollment numbers
+        clustered.push_back(formatID(9000000000ULL + i / 100 * 1000003ULL + i % 100));  // runs of 100 far apart
+    }
+    const std::pair<const char *, const vector<string> *> sets[] = {
+        {"generated", &generated}, {"sequential", &sequential}, {"clustered", &clustered}};
+    for(const auto& set : sets){
+        printf("%s IDs (%lu)\n", set.first, n);
+        hashQuality<StringHash, ModuloRange>("DJBX33A % size", *set.second);
+        hashQuality<StringHash, MaskRange>("DJBX33A & mask", *set.second);
+        hashQuality<StringHash, FastRange>("DJBX33A fastrange", *set.second);
+        hashQuality<NumericIDHash, ModuloRange>("NumericID % size", *set.second);
+        hashQuality<NumericIDHash, MaskRange>("NumericID & mask", *set.second);
+        hashQuality<NumericIDHash, FastRange>("NumericID fastrange", *set.second);
+        hashQuality<WyHash, ModuloRange>("WyHash % size", *set.second);
+        hashQuality<WyHash, MaskRange>("WyHash & mask", *set.second);
+        hashQuality<WyHash, FastRange>("WyHash fastrange", *set.second);
+    }
+}
+
+// Load n students, then look up n IDs (half of them missing) and show what each phase did to the table
+static void reportStats(unsigned long n){
+    vector<string> ids;
+    generator.generateIDs(n, ids);
+    StudentMap table(TABLE_SIZE);
+    for(const string& id : ids){
+        table.put(id, Student("x", id, 18, 4.0));
+    }
+    HashMapStats loaded = table.stats();
+    printf("after loading %lu students:\n", n);
+    loaded.print(stdout);
+    
+    vector<string> lookups;
+    generator.generateIDs(n / 2, lookups);                  // never inserted, so every one of these misses
+    lookups.insert(lookups.end(), ids.begin(), ids.begin() + (n - n / 2));
+    for(const string& id : lookups){
+        table.find(id);
+    }
+    printf("\n%lu lookups later:\n", lookups.size());
+    (table.stats() - loaded).print(stdout);
+#ifndef HASHMAP_STATS
+    printf("(build with make STATS=1 for the probe and resize counters)\n");
+#endif
+    table.stats().writeJSON(stdout);
+}
+
+// Save n generated students as a snapshot, map it back and compare lookups against the HashMap it came from
+static void reportSnapshot(const string& path, unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    StudentMap table(TABLE_SIZE);
+    auto start = steady_clock::now();
+    for(const Student& s : students){
+        table.put(s.getID(), s);
+    }
+    auto loaded = steady_clock::now();
+    if(!StudentSnapshot::write(path, table)){
+        printf("Couldn't write %s\n", path.c_str());
+        return;
+    }
+    auto saved = steady_clock::now();
+    StudentSnapshot snapshot;
+    if(!snapshot.open(path)){
+        printf("Couldn't map %s\n", path.c_str());
+        return;
+    }
+    auto opened = steady_clock::now();
+    bool sound = snapshot.verify();
+    auto verified = steady_clock::now();
+    printf("%lu students | insert %.1f ms | save %.1f ms | open %.3f ms | verify %.1f ms (%s) | "
+           "%.1f bytes/student on disk\n", n,
+           std::chrono::duration<double, std::milli>(loaded - start).count(),
+           std::chrono::duration<double, std::milli>(saved - loaded).count(),
+           std::chrono::duration<double, std::milli>(opened - saved).count(),
+           std::chrono::duration<double, std::milli>(verified - opened).count(), sound ? "ok" : "damaged",
+           static_cast<double>(snapshot.getFileBytes()) / n);
+    
+    std::mt19937_64 rng(7);
+    vector<const string *> lookups(n);
+    for(const string *&id : lookups){
+        id = &students[rng() % n].getID();
+    }
+    unsigned long found = 0;
+    start = steady_clock::now();
+    for(const string *id : lookups){
+        found += table.find(*id) != nullptr;
+    }
+    auto mid = steady_clock::now();
+    for(const string *id : lookups){
+        found += snapshot.find(*id) != nullptr;
+    }
+    auto stop = steady_clock::now();
+    printf("lookup  HashMap %7.2f Mops/s | snapshot %7.2f Mops/s | %lu hits\n",
+           mops(n, start, mid), mops(n, mid, stop), found);
+}
+
+// Write n generated students to path (CSV if it ends in .csv, binary records otherwise) and time importing it
+static void reportImport(const string& path, unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    bool csv = path.length() >= 4 && path.compare(path.length() - 4, 4, ".csv") == 0;
+    FILE *out = fopen(path.c_str(), "wb");
+    if(out == nullptr){
+        printf("Couldn't write %s\n", path.c_str());
+        return;
+    }
+    if(csv){
+        fprintf(out, "name,id,age,gpa\n");
+        for(const Student& s : students){
+            fprintf(out, "%s,%s,%u,%.2f\n", s.getName().c_str(), s.getID().c_str(), s.getAge(), s.getGPA());
+        }
+    }
+    else{
+        fwrite(BINARY_MAGIC, 1, 8, out);
+        BinaryStudent r;
+        for(const Student& s : students){
+            if(packStudent(s, r)){
+                fwrite(&r, sizeof(r), 1, out);
+            }
+        }
+    }
+    fclose(out);
+    
+    unsigned int cores = importThreads(0);
+    for(unsigned int threads : {1u, cores}){
+        StudentMap table(TABLE_SIZE);
+        auto start = steady_clock::now();
+        ImportResult r = importInto(path, table, threads);
+        auto stop = steady_clock::now();
+        printf("%u thread%s | %lu students (%lu rejected) | %.1f ms | %.2f Mstudents/s | %.1f MB/s\n", threads,
+               threads == 1 ? " " : "s", r.imported, r.rejected,
+               std::chrono::duration<double, std::milli>(stop - start).count(), mops(r.imported, start, stop),
+               r.bytes / std::chrono::duration<double, std::micro>(stop - start).count());
+        if(threads == cores){
+            break;                                          // one core: nothing more to compare
+        }
+    }
+}
+
+// Load n students with and without secondary indexes and time the same range and top-K queries on both
+static void reportIndexes(unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    IndexedStudentMap<> indexed(TABLE_SIZE);
+    IndexedStudentMap<> plain(TABLE_SIZE, false, false);
+    auto start = steady_clock::now();
+    for(const Student& s : students){
+        plain.put(s);
+    }
+    auto mid = steady_clock::now();
+    for(const Student& s : students){
+        indexed.put(s);
+    }
+    auto stop = steady_clock::now();
+    printf("insert  plain %7.2f Mops/s | indexed %7.2f Mops/s | indexes %.1f bytes/student\n",
+           mops(n, start, mid), mops(n, mid, stop), static_cast<double>(indexed.indexMemory()) / n);
+    start = steady_clock::now();
+    indexed.rebuildIndexes();
+    printf("rebuild %.1f ms\n", std::chrono::duration<double, std::milli>(steady_clock::now() - start).count());
+    
+    // run one query on both maps and print the rows it matched and its time without and with the indexes
+    auto query = [&plain, &indexed](const char *name, auto run){
+        unsigned long rows[2] = {0, 0};
+        double ms[2];
+        const IndexedStudentMap<> *maps[2] = {&plain, &indexed};
+        for(int m = 0; m < 2; m++){
+            auto begin = steady_clock::now();
+            run(*maps[m], rows[m]);
+            ms[m] = std::chrono::duration<double, std::milli>(steady_clock::now() - begin).count();
+        }
+        printf("%-14s %9lu rows | walk %9.3f ms | index %9.3f ms%s\n", name, rows[1], ms[0], ms[1],
+               rows[0] == rows[1] ? "" : " | MISMATCH");
+    };
+    query("age 20-22", [](const IndexedStudentMap<>& m, unsigned long& rows){
+        m.ageRange(20, 22, [&rows](const Student&){ rows++; });
+    });
+    query("GPA >= 3.5", [](const IndexedStudentMap<>& m, unsigned long& rows){
+        m.gpaRange(3.5, 4.0, [&rows](const Student&){ rows++; });
+    });
+    query("GPA 3.90-3.91", [](const IndexedStudentMap<>& m, unsigned long& rows){
+        m.gpaRange(3.90, 3.91, [&rows](const Student&){ rows++; });
+    });
+    query("top 10 GPA", [](const IndexedStudentMap<>& m, unsigned long& rows){
+        m.topGPA(10, [&rows](const Student&){ rows++; });
+    });
+    query("10 oldest", [](const IndexedStudentMap<>& m, unsigned long& rows){
+        m.oldest(10, [&rows](const Student&){ rows++; });
+    });
+}
+
+// Run the same aggregates over n students by walking the chained table and by scanning columns
+static void reportColumns(unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    StudentMap table(TABLE_SIZE);
+    for(const Student& s : students){
+        table.put(s.getID(), s);
+    }
+    students.clear();
+    students.shrink_to_fit();
+    unsigned int cores = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    StudentColumns columns;
+    auto start = steady_clock::now();
+    columns.build(table, cores);
+    printf("build %.1f ms on %u thread%s | %.1f bytes/student | AVX2 %s\n",
+           std::chrono::duration<double, std::milli>(steady_clock::now() - start).count(), cores, cores == 1 ? "" : "s",
+           static_cast<double>(columns.memoryUsage()) / n, columns.useSIMD(true) ? "yes" : "no");
+    
+    ColumnFilter f;                                         // ages 20 to 22 with a GPA of 3.0 or more
+    f.ageLo = 20;
+    f.ageHi = 22;
+    f.gpaLo = 3.0f;
+    double scanned = n * (sizeof(uint8_t) + sizeof(float)) / 1e9;
+    auto line = [scanned](const char *name, steady_clock::time_point begin, unsigned long rows, double avg){
+        double ms = std::chrono::duration<double, std::milli>(steady_clock::now() - begin).count();
+        printf("%-22s %9.3f ms | %6.2f GB/s of columns | %lu rows, average GPA %.5f\n", name, ms, scanned / ms * 1e3,
+               rows, avg);
+    };
+    
+    start = steady_clock::now();
+    ColumnAggregate walk;
+    table.forEach([&f, &walk](const string&, const Student& s){
+        float g = static_cast<float>(s.getGPA());
+        if(s.getAge() >= f.ageLo && s.getAge() <= f.ageHi && g >= f.gpaLo && g <= f.gpaHi){
+            walk.count++;
+            walk.gpaSum += g;
+        }
+    });
+    line("row walk", start, walk.count, walk.gpaAvg());
+    columns.useSIMD(false);
+    start = steady_clock::now();
+    ColumnAggregate a = columns.aggregate(f);
+    line("columns scalar", start, a.count, a.gpaAvg());
+    if(columns.useSIMD(true)){
+        start = steady_clock::now();
+        a = columns.aggregate(f);
+        line("columns AVX2", start, a.count, a.gpaAvg());
+    }
+    if(cores > 1){
+        start = steady_clock::now();
+        a = columns.aggregate(f, cores);
+        line("columns, every core", start, a.count, a.gpaAvg());
+    }
+    vector<uint32_t> rows;
+    start = steady_clock::now();
+    columns.select(f, rows, cores);
+    line("select", start, rows.size(), 0);
+    
+    AgeGroups groups;
+    start = steady_clock::now();
+    columns.groupByAge(ColumnFilter(), groups, cores);
+    printf("group by age %.3f ms:", std::chrono::duration<double, std::milli>(steady_clock::now() - start).count());
+    for(unsigned int age = 0; age <= COLUMN_MAX_AGE; age++){
+        if(groups.count[age] > 0){
+            printf(" %u:%.3f", age, groups.gpaAvg(age));
+        }
+    }
+    vector<unsigned long> bands(8);
+    start = steady_clock::now();
+    columns.gpaBands(0.5f, bands, cores);
+    printf("\nGPA bands %.3f ms:", std::chrono::duration<double, std::milli>(steady_clock::now() - start).count());
+    for(unsigned long b = 0; b < bands.size(); b++){
+        if(b + 1 < bands.size()){
+            printf(" %.1f-%.1f:%lu", b * 0.5, (b + 1) * 0.5, bands[b]);
+        }
+        else{
+            printf(" %.1f+:%lu", b * 0.5, bands[b]);
+        }
+    }
+    printf("\n");
+}
+
+// Run a mixed read/write workload on a shared table with a number of threads, returns operations per second
+static double runMixed(ConcurrentStudentMap& table, const vector<string>& ids, unsigned int threads,
+                       unsigned int readPercent, unsigned long opsPerThread){
+    using std::chrono::duration;
+    std::atomic<bool> go(false);
+    vector<std::thread> workers;
+    for(unsigned int t = 0; t < threads; t++){
+        workers.emplace_back([&, t](){
+            std::mt19937_64 rng(t + 1);                     // each thread draws its own sequence of operations
+            Student out;
+            unsigned long found = 0;
+            while(!go.load(std::memory_order_acquire)){}
+            for(unsigned long i = 0; i < opsPerThread; i++){
+                const string& id = ids[rng() % ids.size()];
+                if(rng() % 100 < readPercent){
+                    found += table.find(id, out);
+                }
+                else{
+                    table.put(id, Student("x", id, 18, 4.0));   // overwrites, so the table stays the same size
+                }
+            }
+            if(found == ~0UL){                              // keep the lookups from being optimized away
+                printf("?");
+            }
+        });
+    }
+    auto start = steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for(std::thread& w : workers){
+        w.join();
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    return threads * opsPerThread / seconds;
+}
+
+// Throughput of the concurrent table for 99/1, 90/10 and 50/50 read/write mixes from 1 to maxThreads threads
+static void reportScaling(unsigned int maxThreads){
+    const unsigned long keys = 100000;
+    const unsigned long opsPerThread = 1000000;
+    if(maxThreads == 0){
+        maxThreads = std::thread::hardware_concurrency();
+    }
+    vector<string> ids;
+    generator.generateIDs(keys, ids);
+    ConcurrentStudentMap table(TABLE_SIZE);
+    for(const string& id : ids){
+        table.put(id, Student("x", id, 18, 4.0));
+    }
+    
+    const unsigned int mixes[] = {99, 90, 50};
+    printf("%lu keys, %lu operations per thread\n", keys, opsPerThread);
+    printf("threads");
+    for(unsigned int read : mixes){
+        printf(" | %2u/%-2u Mops/s", read, 100 - read);
+    }
+    printf("\n");
+    for(unsigned int threads = 1; threads <= maxThreads; threads = threads * 2 <= maxThreads || threads == maxThreads
+                                                                      ? threads * 2 : maxThreads){
+        printf("%7u", threads);
+        for(unsigned int read : mixes){
+            printf(" | %13.2f", runMixed(table, ids, threads, read, opsPerThread) / 1e6);
+        }
+        printf("\n");
+    }
+}
+
+// 90% lookups, 10% overwrites from one client per shard, next to ConcurrentHashMap with as many threads
+static void reportSharding(unsigned int maxShards){
+    const unsigned long keys = 100000;
+    const unsigned long opsPerClient = 1000000;
+    if(maxShards == 0){
+        maxShards = std::thread::hardware_concurrency();
+    }
+    vector<string> ids;
+    generator.generateIDs(keys, ids);
+    ConcurrentStudentMap locked(TABLE_SIZE);
+    for(const string& id : ids){
+        locked.put(id, Student("x", id, 18, 4.0));
+    }
+    
+    printf("%lu keys, %lu operations per client, 90/10 lookups/overwrites\n", keys, opsPerClient);
+    printf("shards | sharded Mops/s | ConcurrentHashMap Mops/s\n");
+    for(unsigned int shards = 1; shards <= maxShards; shards = shards * 2 <= maxShards || shards == maxShards
+                                                                 ? shards * 2 : maxShards){
+        ShardedStudentMap map(shards, TABLE_SIZE);
+        ShardedStudentMap::Client *loader = map.connect();
+        for(const string& id : ids){
+            loader->put(id, Student("x", id, 18, 4.0));
+        }
+        loader->drain([](const ShardedStudentMap::Op&){});
+        
+        vector<ShardedStudentMap::Client *> clients;
+        for(unsigned int c = 0; c < shards; c++){
+            clients.push_back(map.connect());
+        }
+        std::atomic<bool> go(false);
+        vector<std::thread> workers;
+        for(unsigned int c = 0; c < shards; c++){
+            workers.emplace_back([&, c](){
+                ShardedStudentMap::Client& client = *clients[c];
+                std::mt19937_64 rng(c + 1);
+                auto done = [](const ShardedStudentMap::Op&){};    // only the throughput is measured
+                while(!go.load(std::memory_order_acquire)){}
+                for(unsigned long i = 0; i < opsPerClient; i++){
+                    const string& id = ids[rng() % ids.size()];
+                    if(rng() % 100 < 90){
+                        client.find(id);
+                    }
+                    else{
+                        client.put(id, Student("x", id, 18, 4.0));
+                    }
+                    if(i % SHARD_BATCH == 0){
+                        client.poll(done);
+                    }
+                }
+                client.drain(done);
+            });
+        }
+        auto start = steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for(std::thread& w : workers){
+            w.join();
+        }
+        double sharded = shards * opsPerClient / std::chrono::duration<double>(steady_clock::now() - start).count();
+        printf("%6u | %14.2f | %24.2f\n", shards, sharded / 1e6, runMixed(locked, ids, shards, 90, opsPerClient) / 1e6);
+        if(shards == maxShards){
+            map.printLoad(stdout);
+            break;
+        }
+    }
+}
+
+// Put n generated students through a running server, then get them, check n absent IDs and delete them again
+static void reportServerLoad(const string& socketPath, unsigned long n, unsigned int depth){
+    ServerClient client;
+    if(!client.connect(socketPath)){
+        printf("Couldn't connect to %s\n", socketPath.c_str());
+        return;
+    }
+    if(depth == 0){
+        depth = 1;
+    }
+    vector<Student> students;
+    generator.generate(2 * n, students);                    // the second half never gets stored
+    const char *phases[] = {"PUT", "GET", "EXISTS", "DEL"};
+    const char *expected[] = {"OK", "VALUE ", "0", "1"};   // what every answer of the phase should start with
+    printf("%lu requests a phase, %u per write\n", n, depth);
+    for(int p = 0; p < 4; p++){
+        unsigned long unexpected = 0;
+        std::string batch;
+        auto check = [&unexpected, &expected, p](std::string_view line){
+            unexpected += line.compare(0, strlen(expected[p]), expected[p]) != 0;
+        };
+        auto start = steady_clock::now();
+        for(unsigned long i = 0; i < n; i += depth){
+            unsigned long end = std::min<unsigned long>(i + depth, n);
+            batch.clear();
+            for(unsigned long j = i; j < end; j++){
+                const Student& s = students[p == 2 ? n + j : j];
+                batch += phases[p];
+                batch += ' ';
+                if(p == 0){
+                    char gpa[16];
+                    char *gpaEnd = std::to_chars(gpa, gpa + sizeof(gpa), s.getGPA(), std::chars_format::fixed, 2).ptr;
+                    batch += s.getName();
+                    batch += ',';
+                    batch += s.getID();
+                    batch += ',';
+                    batch += std::to_string(s.getAge());
+                    batch += ',';
+                    batch.append(gpa, gpaEnd);
+                }
+                else{
+                    batch += s.getID();
+                }
+                batch += '\n';
+            }
+            if(!client.request(batch, end - i, check)){
+                printf("The server closed the connection\n");
+                return;
+            }
+        }
+        double seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+        printf("%-6s %10.0f requests/s | %lu unexpected answers\n", phases[p], n / seconds, unexpected);
+    }
+    client.request("STATS\n", 1, [](std::string_view line){
+        printf("%.*s\n", static_cast<int>(line.length()), line.data());
+    });
+}
+
+// Dump n students the way the menu's display() does and through the exporter in every format, all into /dev/null
+static void reportExport(unsigned long n){
+    vector<Student> students;
+    generator.generate(n, students);
+    StudentMap table(TABLE_SIZE);
+    for(Student& s : students){
+        string id = s.getID();
+        table.put(std::move(id), std::move(s));
+    }
+    int sink = open("/dev/null", O_WRONLY);
+    std::ofstream null("/dev/null");
+    if(sink < 0 || !null){
+        printf("Couldn't open /dev/null\n");
+        return;
+    }
+    auto start = steady_clock::now();
+    std::streambuf *saved = std::cout.rdbuf(null.rdbuf());
+    table.finishRehash();
+    for(unsigned long i = 0; i < table.getSize(); i++){     // bucket by bucket, a cout chain per student
+        std::cout << "Hash Value: " << i << "\n";
+        for(auto node = table.bucket(i); node != nullptr; node = node->next){
+            node->value.display();
+        }
+    }
+    std::cout.flush();
+    std::cout.rdbuf(saved);
+    auto stop = steady_clock::now();
+    printf("display()        %8.1f ms | %6.2f Mstudents/s\n",
+           std::chrono::duration<double, std::milli>(stop - start).count(), mops(n, start, stop));
+
+    const char *names[] = {"CSV", "JSON", "binary"};
+    unsigned int cores = importThreads(0);
+    for(ExportFormat format : {EXPORT_CSV, EXPORT_JSON, EXPORT_BINARY}){
+        for(unsigned int threads : {1u, cores}){
+            start = steady_clock::now();
+            ExportResult r = exportTable(table, format, sink, threads);
+            stop = steady_clock::now();
+            printf("%-6s %2u thread%s %8.1f ms | %6.2f Mstudents/s | %7.1f MB/s\n", names[format], threads,
+                   threads == 1 ? " " : "s", std::chrono::duration<double, std::milli>(stop - start).count(),
+                   mops(r.rows, start, stop), r.bytes / std::chrono::duration<double, std::micro>(stop - start).count());
+            if(threads == cores){
+                break;                                      // one core: nothing more to compare
+            }
+        }
+    }
+    close(sink);
+}
+
+// Freeze n students into a FrozenStudentMap on 1 thread and every core, then time hits and misses against the HashMap
+static void reportFrozen(unsigned long n){
+    using std::chrono::duration;
+    vector<Student> students;
+    generator.generate(n, students);
+    vector<string> ids;
+    vector<string> missing;
+    StudentMap table(TABLE_SIZE);
+    for(const Student& s : students){
+        ids.push_back(s.getID());
+        missing.push_back(s.getID());
+        missing.back()[0] = '8';                            // generated IDs all start with 9, so this one can't be present
+        table.put(s.getID(), s);
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64(7));   // look up in a different order than inserted
+
+    FrozenStudentMap frozen;
+    unsigned int cores = importThreads(0);
+    for(unsigned int threads : {1u, cores}){
+        auto start = steady_clock::now();
+        if(!frozen.freeze(table, threads)){
+            printf("Couldn't build a perfect hash over %lu students\n", n);
+            return;
+        }
+        printf("freeze %2u thread%s %8.1f ms | %lu partitions\n", threads, threads == 1 ? " " : "s",
+               duration<double, std::milli>(steady_clock::now() - start).count(), frozen.getPartitions());
+        if(threads == cores){
+            break;                                          // one core: nothing more to compare
+        }
+    }
+    unsigned long entryBytes = frozen.getCount() * sizeof(FrozenStudentMap::Entry);
+    printf("HashMap       %6.1f bytes/student\n", static_cast<double>(table.memoryUsage()) / n);
+    printf("FrozenHashMap %6.1f bytes/student (%.2f bits/student of perfect hash)\n",
+           static_cast<double>(frozen.memoryUsage()) / n, 8.0 * (frozen.memoryUsage() - entryBytes) / n);
+
+    auto timeLookups = [](const char *name, const auto& map, const vector<string>& ids,
+                          const vector<string>& missing){
+        unsigned long found = 0;
+        auto start = steady_clock::now();
+        for(const string& id : ids){
+            found += map.find(id) != nullptr;
+        }
+        auto hit = steady_clock::now();
+        for(const string& id : missing){
+            found += map.find(id) != nullptr;
+        }
+        auto miss = steady_clock::now();
+        double count = static_cast<double>(ids.size());
+        printf("%-13s hit %7.1f ns/op | miss %7.1f ns/op | found %lu of %lu\n", name,
+               duration<double, std::nano>(hit - start).count() / count,
+               duration<double, std::nano>(miss - hit).count() / count, found, ids.size());
+    };
+    const StudentMap& constTable = table;                   // the const find() never migrates
+    timeLookups("HashMap", constTable, ids, missing);
+    timeLookups("FrozenHashMap", frozen, ids, missing);
+}
+
+// Load n students behind Bloom filters of a few false positive rates and time hits and misses with each filter on and off
+static void reportFilter(unsigned long n){
+    using std::chrono::duration;
+    vector<Student> students;
+    generator.generate(n, students);
+    vector<string> ids;
+    vector<string> missing;
+    for(const Student& s : students){
+        ids.push_back(s.getID());
+        missing.push_back(s.getID());
+        missing.back()[0] = '8';                            // generated IDs all start with 9, so this one can't be present
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64(7));   // look up in a different order than inserted
+
+    auto timeLookups = [](const FilteredStudentMap& map, const vector<string>& keys, unsigned long& found){
+        auto start = steady_clock::now();
+        for(const string& id : keys){
+            found += map.find(id) != nullptr;
+        }
+        return duration<double, std::nano>(steady_clock::now() - start).count() / keys.size();
+    };
+    printf("%lu students, %lu absent IDs\n", n, n);
+    printf("  rate | bits/key | k | measured | rebuild ms | hit off/on ns | miss off/on ns\n");
+    for(double rate : {0.1, 0.01, 0.001}){
+        FilteredStudentMap map(TABLE_SIZE, rate);
+        map.bulkLoad([&students](StudentMap& table){
+            for(const Student& s : students){
+                table.put(s.getID(), s);
+            }
+        });
+        auto start = steady_clock::now();
+        map.rebuildFilter();
+        double rebuild = duration<double, std::milli>(steady_clock::now() - start).count();
+        unsigned long positives = 0;
+        for(const string& id : missing){
+            positives += map.mayContain(id);
+        }
+        unsigned long found = 0;
+        map.setFiltering(false);
+        double hitOff = timeLookups(map, ids, found);
+        double missOff = timeLookups(map, missing, found);
+        map.setFiltering(true);
+        double hitOn = timeLookups(map, ids, found);
+        double missOn = timeLookups(map, missing, found);
+        printf("%6.3f | %8.2f | %u | %7.3f%% | %10.1f | %6.1f / %5.1f | %6.1f / %5.1f%s\n", rate,
+               8.0 * map.getFilter().memoryUsage() / n, map.getFilter().getProbes(), 100.0 * positives / n, rebuild,
+               hitOff, hitOn, missOff, missOn, found == 2 * n ? "" : "  (wrong answers)");
+    }
+}
@@ -0,0 +1,299 @@
+/****************************************************************
+ * Blocked Bloom filter and a HashMap with one in front.
+ *
+ * BloomFilter answers "possibly present" or "certainly absent" for
+ * 64-bit hashes. It is blocked: a hash picks one 64-byte block (one
+ * cache line) and all k of its bits are set and tested inside that
+ * block, so a query touches a single cache line however many bits
+ * it checks. The false positive rate it is built for decides the
+ * bits per key and k; blocking costs a little accuracy, which the
+ * sizing pays for with BLOOM_BLOCK_SLACK times as many bits.
+ *
+ * FilteredHashMap owns a chained HashMap and a BloomFilter over the
+ * hashes of its keys. find() tests the filter first, so most misses
+ * are turned away after one cache line instead of hashing into a
+ * bucket and comparing strings along its chain; only hits and false
+ * positives reach the table. Every put() adds its key to the filter.
+ * The filter is sized for a number of keys: once the table holds
+ * more, it is rebuilt for twice as many from the hashes already
+ * stored in the table's nodes (no key is hashed again), the same
+ * amortized doubling the table uses, so until it fills up again
+ * its false positive rate stays below the configured one. erase()
+ * can't clear bits, so erased keys stay "possibly present" until
+ * the next rebuildFilter(). Bulk loads go straight into the table
+ * through bulkLoad(), which rebuilds the filter once at the end;
+ * otherwise the table is only handed out const, so nothing can be
+ * put into it behind the filter's back.
+ *
+ * Hits pay for the filter: one more cache line on top of the
+ * table's own lookup. It is worth it when most lookups miss.
+ ****************************************************************/
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <cstdint>
+#include <cmath>        // log for the sizing
+#include <vector>
+#include "hashmap.h"    // the table behind the filter
+#include "hashfunctions.h"  // foldMultiply and FastRange
+
+#define BLOOM_FP_RATE 0.01      // default false positive rate
+#define BLOOM_BLOCK_SLACK 1.1   // bits a one cache line block needs for the same rate, relative to a plain filter
+#define BLOOM_MAX_PROBES 16     // bits set per key at most
+
+/*************************************************
+ * BloomFilter class contents by section:
+ * 1. BloomFilter block type and data members
+ * 2. BloomFilter constructor prototype
+ * 3. BloomFilter class method prototypes
+ *************************************************/
+class BloomFilter {
+private:
+    // 1.
+    struct alignas(64) Block {
+        uint64_t words[8];
+    };
+    std::vector<Block> blocks;
+    unsigned int probes;                                    // bits set and tested per key (k)
+    unsigned long capacity;                                 // keys the filter was sized for
+    double falsePositiveRate;                               // rate it was sized for
+
+public:
+    // 2.
+    explicit BloomFilter(unsigned long capacity = 0, double falsePositiveRate = BLOOM_FP_RATE);
+
+    // 3.
+    void reset(unsigned long capacity);                     // empty the filter, sized for capacity keys
+    void insert(uint64_t hash);
+    bool mayContain(uint64_t hash) const;                   // false means the key was never inserted
+    unsigned long getCapacity() const;
+    double getFalsePositiveRate() const;
+    unsigned int getProbes() const;
+    unsigned long memoryUsage() const;                      // bytes of the bit array
+};
+
+// Empty filter for capacity keys at the given false positive rate
+inline BloomFilter::BloomFilter(unsigned long capacity, double falsePositiveRate){
+    this->falsePositiveRate = falsePositiveRate > 0 && falsePositiveRate < 1 ? falsePositiveRate : BLOOM_FP_RATE;
+    double bitsPerKey = -std::log(this->falsePositiveRate) / (std::log(2.0) * std::log(2.0));
+    this->probes = static_cast<unsigned int>(std::lround(bitsPerKey * std::log(2.0)));
+    this->probes = this->probes < 1 ? 1 : this->probes > BLOOM_MAX_PROBES ? BLOOM_MAX_PROBES : this->probes;
+    this->reset(capacity);
+}
+
+// Clear every bit and resize for capacity keys
+inline void BloomFilter::reset(unsigned long capacity){
+    double bitsPerKey = -std::log(this->falsePositiveRate) / (std::log(2.0) * std::log(2.0)) * BLOOM_BLOCK_SLACK;
+    unsigned long bits = static_cast<unsigned long>(capacity * bitsPerKey);
+    this->capacity = capacity;
+    this->blocks.assign(bits / 512 + 1, Block());
+}
+
+/*
+ * The block comes from the high bits of the hash (FastRange), the bit
+ * positions from a second multiply: each probe takes the top 9 bits
+ * (which of the block's 512 bits) and multiplies again for the next.
+ */
+inline void BloomFilter::insert(uint64_t hash){
+    Block& b = this->blocks[FastRange::bucket(hash, this->blocks.size())];
+    uint64_t bits = foldMultiply(hash, 0xE7037ED1A0B428DBULL);
+    for(unsigned int i = 0; i < this->probes; i++){
+        b.words[bits >> 61] |= 1ULL << ((bits >> 55) & 63);
+        bits *= 0x9E3779B97F4A7C15ULL;
+    }
+}
+
+// True if every bit of the hash is set (a false positive with about the configured probability)
+inline bool BloomFilter::mayContain(uint64_t hash) const{
+    const Block& b = this->blocks[FastRange::bucket(hash, this->blocks.size())];
+    uint64_t bits = foldMultiply(hash, 0xE7037ED1A0B428DBULL);
+    uint64_t all = 1;                                       // no early exit: the line is loaded either way, and
+    for(unsigned int i = 0; i < this->probes; i++){         // no branch means no mispredicted misses
+        all &= b.words[bits >> 61] >> ((bits >> 55) & 63);
+        bits *= 0x9E3779B97F4A7C15ULL;
+    }
+    return all & 1;
+}
+
+// Keys the filter was sized for
+inline unsigned long BloomFilter::getCapacity() const{
+    return this->capacity;
+}
+
+// False positive rate the filter was sized for
+inline double BloomFilter::getFalsePositiveRate() const{
+    return this->falsePositiveRate;
+}
+
+// Bits set and tested per key
+inline unsigned int BloomFilter::getProbes() const{
+    return this->probes;
+}
+
+// Bytes of the bit array
+inline unsigned long BloomFilter::memoryUsage() const{
+    return this->blocks.capacity() * sizeof(Block);
+}
+
+/*************************************************
+ * FilteredHashMap class contents by section:
+ * 1. FilteredHashMap class private data members
+ * 2. FilteredHashMap private helper prototypes
+ * 3. FilteredHashMap constructor prototype
+ * 4. FilteredHashMap class method prototypes
+ *************************************************/
+template <class Key, class Value, class Hash = std::hash<Key>, class Eq = std::equal_to<Key>,
+          class Pool = HeapPool, class Range = ModuloRange>
+class FilteredHashMap {
+public:
+    using Table = HashMap<Key, Value, Hash, Eq, Pool, Range>;
+
+private:
+    // 1.
+    Table table;                                            // owns the entries
+    BloomFilter filter;                                     // over the remixed hash of every key put
+    bool filtering;                                         // false sends every lookup to the table
+
+    // 2.
+    static uint64_t filterHash(unsigned long hash);         // the table's hash remixed so its high bits vary
+
+public:
+    // 3.
+    explicit FilteredHashMap(unsigned long size, double falsePositiveRate = BLOOM_FP_RATE);
+
+    // 4.
+    const Table& getTable() const;                          // read only, puts must go through put() or bulkLoad()
+    const BloomFilter& getFilter() const;
+    unsigned long getCount() const;
+    unsigned long memoryUsage() const;                      // bytes held by the table and the filter
+    void setFiltering(bool on);                             // turn the filter off to compare, it is still kept up to date
+    void finishRehash();                                    // finish the table's pending growth, e.g. before walking buckets
+    Value& put(Key key, Value value);                       // insert into the table and the filter
+    template <class K>
+    bool mayContain(const K& key) const;                    // the filter's answer alone, false if key is surely absent
+    template <class K>
+    Value *find(const K& key);                              // nullptr straight away when the filter rules key out
+    template <class K>
+    const Value *find(const K& key) const;
+    template <class K>
+    bool erase(const K& key);                               // the key stays in the filter until it is rebuilt
+    template <class L>
+    void bulkLoad(L load);                                  // load(table) straight into the table, then rebuild
+    void rebuildFilter(unsigned long capacity = 0);         // size the filter for capacity keys (0: the count) and refill it
+};
+
+// Empty table of size buckets behind an empty filter
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::FilteredHashMap(unsigned long size, double falsePositiveRate)
+    : table(size), filter(size, falsePositiveRate){
+    this->filtering = true;
+}
+
+// Bucket hashes such as DJBX33A barely move their high bits; the filter needs every bit to vary
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+inline uint64_t FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::filterHash(unsigned long hash){
+    return foldMultiply(hash ^ 0xA0761D6478BD642FULL, 0x8EBC6AF09C88C6E3ULL);
+}
+
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+const typename FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::Table& FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::getTable() const{
+    return this->table;
+}
+
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+const BloomFilter& FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::getFilter() const{
+    return this->filter;
+}
+
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+unsigned long FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::getCount() const{
+    return this->table.getCount();
+}
+
+// Bytes held by the table's buckets and nodes plus the filter's bits
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+unsigned long FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::memoryUsage() const{
+    return this->table.memoryUsage() + this->filter.memoryUsage();
+}
+
+// Turn the filter in front of find() on or off
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::setFiltering(bool on){
+    this->filtering = on;
+}
+
+// Migrate the table's remaining buckets (nodes keep their hashes, so the filter is unaffected)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::finishRehash(){
+    this->table.finishRehash();
+}
+
+// Insert into the table and the filter, growing the filter once it holds more keys than it was sized for
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+Value& FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::put(Key key, Value value){
+    unsigned long hash = this->table.hashKey(key);          // hashed once for both the table and the filter
+    Value& stored = this->table.put(std::move(key), std::move(value), hash);
+    if(this->table.getCount() > this->filter.getCapacity()){
+        this->rebuildFilter(2 * this->table.getCount());    // includes the key just put
+    }
+    else{
+        this->filter.insert(filterHash(hash));
+    }
+    return stored;
+}
+
+// The filter's answer for key, without looking in the table
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+bool FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::mayContain(const K& key) const{
+    return this->filter.mayContain(filterHash(this->table.hashKey(key)));
+}
+
+// Ask the filter first, only keys it can't rule out are searched for in the table
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+Value *FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::find(const K& key){
+    if(this->filtering && !this->mayContain(key)){
+        return nullptr;
+    }
+    return this->table.find(key);
+}
+
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+const Value *FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::find(const K& key) const{
+    if(this->filtering && !this->mayContain(key)){
+        return nullptr;
+    }
+    return this->table.find(key);
+}
+
+// Remove the newest entry for key from the table (its bits stay set in the filter)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+bool FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::erase(const K& key){
+    return this->table.erase(key);
+}
+
+// Let load(table) fill the table directly (e.g. importInto), then rebuild the filter once
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class L>
+void FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::bulkLoad(L load){
+    load(this->table);
+    this->rebuildFilter();
+}
+
+// Resize the filter for capacity keys (at least the current count) and refill it from the hashes stored in the nodes
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void FilteredHashMap<Key, Value, Hash, Eq, Pool, Range>::rebuildFilter(unsigned long capacity){
+    this->table.finishRehash();
+    this->filter.reset(capacity > this->table.getCount() ? capacity : this->table.getCount());
+    for(unsigned long i = 0; i < this->table.getSize(); i++){
+        for(auto node = this->table.bucket(i); node != nullptr; node = node->next){
+            this->filter.insert(filterHash(node->hash));
+        }
+    }
+}
+
+#endif //BLOOMFILTER_H
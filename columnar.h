@@ -0,0 +1,440 @@
+/****************************************************************
+ * Columnar shadow of Student age and GPA.
+ *
+ * StudentColumns copies the age and GPA of every student of a
+ * chained table into two dense arrays (struct of arrays): ages as
+ * bytes and GPAs as floats, 5 bytes a student, plus a third array
+ * pointing back at each record for queries that need the rest of
+ * it. A scan then streams through memory in order instead of
+ * chasing one node pointer per student.
+ *
+ * Kernels:
+ *   - aggregate(): count, GPA sum, minimum and maximum of the rows
+ *     passing a ColumnFilter (age range and GPA range), in one pass
+ *   - select(): the row numbers passing a filter
+ *   - groupByAge(): rows and GPA sum for every age
+ *   - gpaBands(): rows in every GPA band of a given width
+ * aggregate() and select() test 8 rows per instruction with AVX2
+ * on x86-64 CPUs that have it (chosen at run time, the build stays
+ * generic) and fall back to plain loops elsewhere or when
+ * useSIMD(false) is called. The two group-bys scatter into small
+ * tables, which SIMD doesn't help with, so they stay scalar and
+ * spread their updates over several copies of the table to avoid
+ * waiting on the previous row's store. Every kernel can split the
+ * rows over threads, and build() splits the table's buckets.
+ *
+ * The shadow is a copy: after changing the table, build() it again
+ * (append() adds students inserted since).
+ ****************************************************************/
+
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cstdint>
+#include <cmath>        // INFINITY for empty minimum and maximum
+#include <vector>
+#include <thread>       // kernels and build() split their work over threads
+#include "student.h"    // Student records and HashMap
+#if defined(__x86_64__)
+#include <immintrin.h>  // AVX2 kernels, compiled for AVX2 alone through the target attribute
+#define COLUMNS_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
+#define COLUMN_BLOCK 2048       // rows summed in float lanes before the partial sum moves to a double
+#define COLUMN_MAX_AGE 255      // ages are stored in a byte, older ones are clamped
+#define COLUMN_SPREAD 4         // copies of each group-by table, so consecutive rows rarely update the same counter
+
+// Rows a kernel should look at: ageLo <= age <= ageHi and gpaLo <= GPA <= gpaHi
+struct ColumnFilter {
+    unsigned int ageLo = 0;
+    unsigned int ageHi = COLUMN_MAX_AGE;
+    float gpaLo = -INFINITY;
+    float gpaHi = INFINITY;
+};
+
+// What aggregate() found
+struct ColumnAggregate {
+    unsigned long count = 0;                                // rows that passed the filter
+    double gpaSum = 0;
+    float gpaMin = INFINITY;                                // INFINITY if no row passed
+    float gpaMax = -INFINITY;                               // -INFINITY if no row passed
+
+    double gpaAvg() const{ return this->count > 0 ? this->gpaSum / this->count : 0; }
+    void merge(const ColumnAggregate& o){
+        this->count += o.count;
+        this->gpaSum += o.gpaSum;
+        this->gpaMin = o.gpaMin < this->gpaMin ? o.gpaMin : this->gpaMin;
+        this->gpaMax = o.gpaMax > this->gpaMax ? o.gpaMax : this->gpaMax;
+    }
+};
+
+// What groupByAge() found: rows and GPA sum for every age
+struct AgeGroups {
+    unsigned long count[COLUMN_MAX_AGE + 1] = {};
+    double gpaSum[COLUMN_MAX_AGE + 1] = {};
+
+    double gpaAvg(unsigned int age) const{ return this->count[age] > 0 ? this->gpaSum[age] / this->count[age] : 0; }
+};
+
+/*************************************************
+ * StudentColumns class contents by section:
+ * 1. StudentColumns class private data members
+ * 2. StudentColumns private helper prototypes
+ * 3. StudentColumns constructor prototype
+ * 4. StudentColumns class method prototypes
+ *************************************************/
+class StudentColumns {
+private:
+    // 1.
+    std::vector<uint8_t> ages;
+    std::vector<float> gpas;
+    std::vector<const Student *> records;                   // the student each row was copied from
+    bool simd;                                              // AVX2 kernels are available and turned on
+
+    // 2.
+    static unsigned int threadCount(unsigned int threads);  // 0 means every core
+    template <class F>
+    static void parallel(unsigned long n, unsigned int threads, F work);   // work(thread, begin, end) on each slice
+    void aggregateScalar(const ColumnFilter& f, unsigned long begin, unsigned long end, ColumnAggregate& out) const;
+    void selectScalar(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                      std::vector<uint32_t>& out) const;
+#ifdef COLUMNS_AVX2
+    COLUMNS_AVX2 void aggregateAVX2(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                                    ColumnAggregate& out) const;
+    COLUMNS_AVX2 void selectAVX2(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                                 std::vector<uint32_t>& out) const;
+#endif
+
+public:
+    // 3.
+    StudentColumns();
+
+    // 4.
+    unsigned long getCount() const;
+    unsigned long memoryUsage() const;                      // bytes held by the three columns
+    bool useSIMD(bool on);                                  // pick the AVX2 or the scalar kernels, true if AVX2 is in use
+    void clear();
+    void append(const Student& s);                          // add one row
+    template <class Pool, class Range>
+    void build(HashMap<string, Student, StringHash, StringEq, Pool, Range>& table,
+               unsigned int threads = 1);                   // copy each student once, each thread taking a range of buckets
+    const Student& record(unsigned long row) const;         // the student a row came from
+    ColumnAggregate aggregate(const ColumnFilter& f, unsigned int threads = 1) const;
+    unsigned long count(const ColumnFilter& f, unsigned int threads = 1) const;
+    void select(const ColumnFilter& f, std::vector<uint32_t>& rows, unsigned int threads = 1) const;
+    void groupByAge(const ColumnFilter& f, AgeGroups& out, unsigned int threads = 1) const;
+    void gpaBands(float width, std::vector<unsigned long>& counts,
+                  unsigned int threads = 1) const;          // counts[b] = rows with b * width <= GPA < (b + 1) * width
+};
+
+// Empty columns, using AVX2 if the CPU has it
+inline StudentColumns::StudentColumns(){
+    this->simd = false;
+    this->useSIMD(true);
+}
+
+// Number of rows
+inline unsigned long StudentColumns::getCount() const{
+    return this->ages.size();
+}
+
+// Bytes held by the three columns
+inline unsigned long StudentColumns::memoryUsage() const{
+    return this->ages.capacity() * sizeof(uint8_t) + this->gpas.capacity() * sizeof(float) +
+           this->records.capacity() * sizeof(const Student *);
+}
+
+// Turn the AVX2 kernels on or off (they stay off on CPUs without AVX2)
+inline bool StudentColumns::useSIMD(bool on){
+#ifdef COLUMNS_AVX2
+    this->simd = on && __builtin_cpu_supports("avx2");
+#else
+    this->simd = false;
+    (void)on;
+#endif
+    return this->simd;
+}
+
+// Drop every row
+inline void StudentColumns::clear(){
+    this->ages.clear();
+    this->gpas.clear();
+    this->records.clear();
+}
+
+// Add one student as the last row
+inline void StudentColumns::append(const Student& s){
+    this->ages.push_back(static_cast<uint8_t>(s.getAge() > COLUMN_MAX_AGE ? COLUMN_MAX_AGE : s.getAge()));
+    this->gpas.push_back(static_cast<float>(s.getGPA()));
+    this->records.push_back(&s);
+}
+
+/*
+ * Replace the rows with every student of table that find() can
+ * return (a student put again is copied once, as its newest record).
+ * Each thread copies a range of buckets into its own columns, and the
+ * slices are then concatenated in bucket order.
+ */
+template <class Pool, class Range>
+void StudentColumns::build(HashMap<string, Student, StringHash, StringEq, Pool, Range>& table, unsigned int threads){
+    table.finishRehash();                                   // so every node is reachable through bucket()
+    this->clear();
+    threads = threadCount(threads);
+    std::vector<StudentColumns> slices(threads);
+    parallel(table.getSize(), threads,
+             [&table, &slices](unsigned int t, unsigned long begin, unsigned long end){
+        for(unsigned long i = begin; i < end; i++){
+            for(auto node = table.bucket(i); node != nullptr; node = node->next){
+                if(!table.isShadowed(i, node)){
+                    slices[t].append(node->value);
+                }
+            }
+        }
+    });
+    this->ages.reserve(table.getCount());
+    this->gpas.reserve(table.getCount());
+    this->records.reserve(table.getCount());
+    for(const StudentColumns& s : slices){
+        this->ages.insert(this->ages.end(), s.ages.begin(), s.ages.end());
+        this->gpas.insert(this->gpas.end(), s.gpas.begin(), s.gpas.end());
+        this->records.insert(this->records.end(), s.records.begin(), s.records.end());
+    }
+}
+
+// The student a row was copied from
+inline const Student& StudentColumns::record(unsigned long row) const{
+    return *this->records[row];
+}
+
+// Threads to use when the caller passes 0
+inline unsigned int StudentColumns::threadCount(unsigned int threads){
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    return threads > 0 ? threads : 1;
+}
+
+// Split [0, n) into one contiguous slice per thread (threadCount() of them) and run work(thread, begin, end) on each
+template <class F>
+void StudentColumns::parallel(unsigned long n, unsigned int threads, F work){
+    if(threads <= 1){
+        work(0U, 0UL, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for(unsigned int t = 1; t < threads; t++){
+        workers.emplace_back(work, t, n * t / threads, n * (t + 1) / threads);
+    }
+    work(0U, 0UL, n / threads);                             // the calling thread takes the first slice
+    for(std::thread& w : workers){
+        w.join();
+    }
+}
+
+// One row at a time (the summing order matches the AVX2 kernel's only to within float rounding)
+inline void StudentColumns::aggregateScalar(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                                            ColumnAggregate& out) const{
+    for(unsigned long i = begin; i < end; i++){
+        float g = this->gpas[i];
+        if(this->ages[i] >= f.ageLo && this->ages[i] <= f.ageHi && g >= f.gpaLo && g <= f.gpaHi){
+            out.count++;
+            out.gpaSum += g;
+            out.gpaMin = g < out.gpaMin ? g : out.gpaMin;
+            out.gpaMax = g > out.gpaMax ? g : out.gpaMax;
+        }
+    }
+}
+
+// Row numbers passing the filter, one row at a time
+inline void StudentColumns::selectScalar(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                                         std::vector<uint32_t>& out) const{
+    for(unsigned long i = begin; i < end; i++){
+        float g = this->gpas[i];
+        if(this->ages[i] >= f.ageLo && this->ages[i] <= f.ageHi && g >= f.gpaLo && g <= f.gpaHi){
+            out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#ifdef COLUMNS_AVX2
+// The filter of rows i to i + 7 as a vector mask: widen 8 ages to 32 bits, compare both columns and combine
+#define COLUMNS_MASK8(i)                                                                                        \
+    _mm256_and_ps(_mm256_castsi256_ps(_mm256_and_si256(                                                         \
+                      _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(                                  \
+                          reinterpret_cast<const __m128i *>(this->ages.data() + (i)))), ageBelow),              \
+                      _mm256_cmpgt_epi32(ageAbove, _mm256_cvtepu8_epi32(_mm_loadl_epi64(                        \
+                          reinterpret_cast<const __m128i *>(this->ages.data() + (i))))))),                      \
+                  _mm256_and_ps(_mm256_cmp_ps(g, gpaLo, _CMP_GE_OQ), _mm256_cmp_ps(g, gpaHi, _CMP_LE_OQ)))
+
+// 8 rows per step: count with a popcount of the mask, sum, minimum and maximum over the masked GPAs
+COLUMNS_AVX2 inline void StudentColumns::aggregateAVX2(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                                                       ColumnAggregate& out) const{
+    const __m256i ageBelow = _mm256_set1_epi32(static_cast<int>(f.ageLo) - 1);
+    const __m256i ageAbove = _mm256_set1_epi32(static_cast<int>(f.ageHi) + 1);
+    const __m256 gpaLo = _mm256_set1_ps(f.gpaLo);
+    const __m256 gpaHi = _mm256_set1_ps(f.gpaHi);
+    const __m256 inf = _mm256_set1_ps(INFINITY);
+    const __m256 negInf = _mm256_set1_ps(-INFINITY);
+    __m256 lo = inf;
+    __m256 hi = negInf;
+    unsigned long i = begin;
+    while(i + 8 <= end){
+        __m256 sum = _mm256_setzero_ps();                   // float lanes only hold a block's worth accurately
+        unsigned long blockEnd = end - i > COLUMN_BLOCK ? i + COLUMN_BLOCK : end;
+        for(; i + 8 <= blockEnd; i += 8){
+            __m256 g = _mm256_loadu_ps(this->gpas.data() + i);
+            __m256 mask = COLUMNS_MASK8(i);
+            out.count += __builtin_popcount(_mm256_movemask_ps(mask));
+            sum = _mm256_add_ps(sum, _mm256_and_ps(mask, g));
+            lo = _mm256_min_ps(lo, _mm256_blendv_ps(inf, g, mask));
+            hi = _mm256_max_ps(hi, _mm256_blendv_ps(negInf, g, mask));
+        }
+        float lanes[8];
+        _mm256_storeu_ps(lanes, sum);
+        for(float l : lanes){
+            out.gpaSum += l;
+        }
+    }
+    float los[8];
+    float his[8];
+    _mm256_storeu_ps(los, lo);
+    _mm256_storeu_ps(his, hi);
+    for(int l = 0; l < 8; l++){
+        out.gpaMin = los[l] < out.gpaMin ? los[l] : out.gpaMin;
+        out.gpaMax = his[l] > out.gpaMax ? his[l] : out.gpaMax;
+    }
+    this->aggregateScalar(f, i, end, out);                  // the last few rows
+}
+
+// 8 rows per step, appending the set bits of each mask
+COLUMNS_AVX2 inline void StudentColumns::selectAVX2(const ColumnFilter& f, unsigned long begin, unsigned long end,
+                                                    std::vector<uint32_t>& out) const{
+    const __m256i ageBelow = _mm256_set1_epi32(static_cast<int>(f.ageLo) - 1);
+    const __m256i ageAbove = _mm256_set1_epi32(static_cast<int>(f.ageHi) + 1);
+    const __m256 gpaLo = _mm256_set1_ps(f.gpaLo);
+    const __m256 gpaHi = _mm256_set1_ps(f.gpaHi);
+    unsigned long i = begin;
+    for(; i + 8 <= end; i += 8){
+        __m256 g = _mm256_loadu_ps(this->gpas.data() + i);
+        for(unsigned int bits = _mm256_movemask_ps(COLUMNS_MASK8(i)); bits != 0; bits &= bits - 1){
+            out.push_back(static_cast<uint32_t>(i + __builtin_ctz(bits)));
+        }
+    }
+    this->selectScalar(f, i, end, out);
+}
+#undef COLUMNS_MASK8
+#endif
+
+// Count, GPA sum, minimum and maximum of the rows passing f
+inline ColumnAggregate StudentColumns::aggregate(const ColumnFilter& f, unsigned int threads) const{
+    threads = threadCount(threads);
+    std::vector<ColumnAggregate> parts(threads);
+    parallel(this->getCount(), threads, [this, &f, &parts](unsigned int t, unsigned long begin, unsigned long end){
+#ifdef COLUMNS_AVX2
+        if(this->simd){
+            this->aggregateAVX2(f, begin, end, parts[t]);
+            return;
+        }
+#endif
+        this->aggregateScalar(f, begin, end, parts[t]);
+    });
+    ColumnAggregate total;
+    for(const ColumnAggregate& p : parts){
+        total.merge(p);
+    }
+    return total;
+}
+
+// Rows passing f
+inline unsigned long StudentColumns::count(const ColumnFilter& f, unsigned int threads) const{
+    return this->aggregate(f, threads).count;
+}
+
+// Replace rows with the row numbers passing f, in ascending order
+inline void StudentColumns::select(const ColumnFilter& f, std::vector<uint32_t>& rows, unsigned int threads) const{
+    threads = threadCount(threads);
+    std::vector<std::vector<uint32_t>> parts(threads);
+    parallel(this->getCount(), threads, [this, &f, &parts](unsigned int t, unsigned long begin, unsigned long end){
+#ifdef COLUMNS_AVX2
+        if(this->simd){
+            this->selectAVX2(f, begin, end, parts[t]);
+            return;
+        }
+#endif
+        this->selectScalar(f, begin, end, parts[t]);
+    });
+    rows.clear();
+    for(const std::vector<uint32_t>& p : parts){
+        rows.insert(rows.end(), p.begin(), p.end());
+    }
+}
+
+// Rows and GPA sum for every age, over the rows passing f
+inline void StudentColumns::groupByAge(const ColumnFilter& f, AgeGroups& out, unsigned int threads) const{
+    threads = threadCount(threads);
+    std::vector<AgeGroups> parts(threads * COLUMN_SPREAD);
+    parallel(this->getCount(), threads, [this, &f, &parts](unsigned int t, unsigned long begin, unsigned long end){
+        AgeGroups *spread = &parts[t * COLUMN_SPREAD];
+        auto add = [this, &f](AgeGroups& group, unsigned long i){
+            float g = this->gpas[i];
+            uint8_t age = this->ages[i];
+            bool pass = age >= f.ageLo && age <= f.ageHi && g >= f.gpaLo && g <= f.gpaHi;
+            group.count[age] += pass;
+            group.gpaSum[age] += pass ? g : 0.0f;
+        };
+        unsigned long i = begin;
+        for(; i + COLUMN_SPREAD <= end; i += COLUMN_SPREAD){
+            for(unsigned int c = 0; c < COLUMN_SPREAD; c++){    // each of the rows updates its own copy
+                add(spread[c], i + c);
+            }
+        }
+        for(; i < end; i++){
+            add(spread[0], i);
+        }
+    });
+    out = AgeGroups();
+    for(const AgeGroups& p : parts){
+        for(unsigned int age = 0; age <= COLUMN_MAX_AGE; age++){
+            out.count[age] += p.count[age];
+            out.gpaSum[age] += p.gpaSum[age];
+        }
+    }
+}
+
+// Rows in every GPA band of the given width, the last band holding everything above it
+inline void StudentColumns::gpaBands(float width, std::vector<unsigned long>& counts, unsigned int threads) const{
+    unsigned long bands = counts.size();
+    if(bands == 0 || width <= 0){
+        return;
+    }
+    float scale = 1.0f / width;
+    threads = threadCount(threads);
+    std::vector<unsigned long> parts(threads * COLUMN_SPREAD * bands);
+    parallel(this->getCount(), threads, [&](unsigned int t, unsigned long begin, unsigned long end){
+        unsigned long *spread = &parts[t * COLUMN_SPREAD * bands];
+        float last = static_cast<float>(bands - 1);
+        auto band = [this, scale, last](unsigned long i){
+            float b = this->gpas[i] * scale;
+            b = b > 0.0f ? b : 0.0f;                        // maxss/minss, no branches
+            b = b < last ? b : last;
+            return static_cast<unsigned int>(static_cast<int>(b));  // signed conversion is a single instruction
+        };
+        unsigned long i = begin;
+        for(; i + COLUMN_SPREAD <= end; i += COLUMN_SPREAD){
+            for(unsigned int c = 0; c < COLUMN_SPREAD; c++){
+                spread[c * bands + band(i + c)]++;
+            }
+        }
+        for(; i < end; i++){
+            spread[band(i)]++;
+        }
+    });
+    for(unsigned long b = 0; b < bands; b++){
+        counts[b] = 0;
+    }
+    for(unsigned long i = 0; i < parts.size(); i++){
+        counts[i % bands] += parts[i];
+    }
+}
+
+#endif //COLUMNAR_H
@@ -0,0 +1,205 @@
+/****************************************************************
+ * Compact student records.
+ *
+ * A Student carries two std::strings, an int and a double, and
+ * every entry of a string keyed table carries a third string for
+ * the key. For a 10-digit numeric ID that is far more than needed,
+ * so the compact mode stores:
+ *   - the ID as a 64-bit integer key (compared with one instruction),
+ *   - the name as a 32-bit index into a shared StringPool, since the
+ *     same few thousand names repeat across millions of students,
+ *   - the GPA in hundredths and the age in a byte.
+ * A CompactStudent is 8 bytes, so a FlatHashMap slot is 16 bytes
+ * plus its one byte hash tag, which rejects almost every mismatch
+ * before the key is even loaded.
+ ****************************************************************/
+
+#ifndef COMPACTSTUDENT_H
+#define COMPACTSTUDENT_H
+
+#include <cstdint>      // fixed width record fields
+#include <deque>        // stable storage for interned strings
+#include <string>
+#include <string_view>
+#include "hashmap.h"    // StringHash/StringEq
+#include "flathashmap.h"    // the table compact records are stored in
+
+/*
+ * Murmur3 finalizer: every input bit affects every output bit, so
+ * sequential or clustered integer IDs still spread over the table.
+ */
+struct IDHash {
+    unsigned long operator()(uint64_t id) const{
+        id ^= id >> 33;
+        id *= 0xFF51AFD7ED558CCDULL;
+        id ^= id >> 33;
+        id *= 0xC4CEB9FE1A85EC53ULL;
+        id ^= id >> 33;
+        return id;
+    }
+};
+
+// Parse a 10-digit ID into an integer, returns false if it isn't 10 digits
+inline bool parseID(std::string_view str, uint64_t& id){
+    return parseDigits10(str, id);                          // SWAR parse, see hashfunctions.h
+}
+
+// Format an integer ID back into its 10-digit form (leading zeros included)
+inline std::string formatID(uint64_t id){
+    std::string str(10, '0');
+    for(int i = 9; i >= 0; i--){
+        str[i] = static_cast<char>('0' + id % 10);
+        id /= 10;
+    }
+    return str;
+}
+
+/**************************************************
+ * StringPool class contents by section:
+ * 1. StringPool class private data members
+ * 2. StringPool class method prototypes
+ *
+ * Interns strings so each distinct one is stored once
+ * and referred to by a 32-bit index.
+ **************************************************/
+class StringPool {
+private:
+    // 1.
+    std::deque<std::string> strings;                        // a deque never moves its elements, so views stay valid
+    FlatHashMap<std::string_view, uint32_t, StringHash, StringEq> lookup;   // string -> index
+    unsigned long bytes = 0;                                // heap bytes held by long strings
+
+public:
+    // 2.
+    StringPool() : lookup(64) {}
+    uint32_t intern(std::string_view s);                    // index of s, adding it on first sight
+    std::string_view get(uint32_t index) const;             // the string stored at index
+    unsigned long getCount() const;                         // number of distinct strings
+    unsigned long memoryUsage() const;                      // bytes held by the pool
+};
+
+// Index of s in the pool, adding it on first sight
+inline uint32_t StringPool::intern(std::string_view s){
+    const uint32_t *found = this->lookup.find(s);
+    if(found != nullptr){
+        return *found;
+    }
+    auto index = static_cast<uint32_t>(this->strings.size());
+    this->strings.emplace_back(s);
+    if(this->strings.back().capacity() > 15){               // past the small string buffer it lives on the heap
+        this->bytes += this->strings.back().capacity() + 1;
+    }
+    this->lookup.put(this->strings.back(), index);          // the key views the pooled copy, not the caller's
+    return index;
+}
+
+// The string stored at index
+inline std::string_view StringPool::get(uint32_t index) const{
+    return this->strings[index];
+}
+
+// Number of distinct strings in the pool
+inline unsigned long StringPool::getCount() const{
+    return this->strings.size();
+}
+
+// Bytes held by the pool's strings and lookup table
+inline unsigned long StringPool::memoryUsage() const{
+    return this->strings.size() * sizeof(std::string) + this->bytes + this->lookup.memoryUsage();
+}
+
+// A student without its ID, which is the table key
+struct CompactStudent {
+    uint32_t name;                                          // index of the name in the table's StringPool
+    uint16_t gpa;                                           // GPA in hundredths (0 - 400)
+    uint8_t age;                                            // age in years
+};
+
+/*************************************************
+ * CompactStudentTable class contents by section:
+ * 1. CompactStudentTable class private data members
+ * 2. CompactStudentTable constructor prototype
+ * 3. CompactStudentTable class method prototypes
+ *************************************************/
+class CompactStudentTable {
+private:
+    // 1.
+    FlatHashMap<uint64_t, CompactStudent, IDHash> table;    // integer ID -> packed record
+    StringPool names;                                       // every distinct name, stored once
+
+public:
+    // 2.
+    explicit CompactStudentTable(unsigned long size) : table(size) {}
+
+    // 3.
+    bool put(std::string_view name, std::string_view id,
+             unsigned int age, double gpa);                 // insert or replace a student, false if the ID isn't 10 digits
+    const CompactStudent *find(std::string_view id) const;  // the record for this ID or nullptr
+    const CompactStudent *find(uint64_t id) const;          // same, for an already parsed ID
+    std::string_view getName(const CompactStudent& s) const;    // resolve a record's pooled name
+    unsigned int getSize() const;                           // number of slots
+    unsigned long getCount() const;                         // number of students
+    unsigned long memoryUsage() const;                      // bytes held by the table and its name pool
+    template <class F>
+    void forEach(F visit) const;                            // call visit(id, record) for every student
+};
+
+// Insert a student, or overwrite the record of one already in the table; returns false if the ID isn't 10 digits
+inline bool CompactStudentTable::put(std::string_view name, std::string_view id, unsigned int age, double gpa){
+    uint64_t key;
+    if(!parseID(id, key)){
+        return false;
+    }
+    CompactStudent s{};
+    s.name = this->names.intern(name);
+    gpa = gpa > 0 ? gpa : 0;                                // clamp to what 16 bits of hundredths hold, NaN to 0
+    s.gpa = static_cast<uint16_t>(gpa < 655.35 ? gpa * 100 + 0.5 : 65535);   // round to the nearest hundredth
+    s.age = static_cast<uint8_t>(age > 255 ? 255 : age);
+    CompactStudent *existing = this->table.find(key);
+    if(existing != nullptr){
+        *existing = s;                                      // the old name stays pooled, other students may share it
+    }
+    else{
+        this->table.put(key, s);
+    }
+    return true;
+}
+
+// Find a student by its 10-digit ID
+inline const CompactStudent *CompactStudentTable::find(std::string_view id) const{
+    uint64_t key;
+    return parseID(id, key) ? this->table.find(key) : nullptr;
+}
+
+// Find a student by its integer ID
+inline const CompactStudent *CompactStudentTable::find(uint64_t id) const{
+    return this->table.find(id);
+}
+
+// Resolve a record's pooled name
+inline std::string_view CompactStudentTable::getName(const CompactStudent& s) const{
+    return this->names.get(s.name);
+}
+
+// CompactStudentTable slot count getter
+inline unsigned int CompactStudentTable::getSize() const{
+    return this->table.getSize();
+}
+
+// CompactStudentTable student count getter
+inline unsigned long CompactStudentTable::getCount() const{
+    return this->table.getCount();
+}
+
+// Bytes held by the table and its name pool
+inline unsigned long CompactStudentTable::memoryUsage() const{
+    return this->table.memoryUsage() + this->names.memoryUsage();
+}
+
+// Visit every student as (integer ID, record)
+template <class F>
+void CompactStudentTable::forEach(F visit) const{
+    this->table.forEach(visit);
+}
+
+#endif //COMPACTSTUDENT_H
@@ -0,0 +1,300 @@
+/****************************************************************
+ * Thread safe hash map with lock-free reads.
+ *
+ * ConcurrentHashMap<Key, Value, Hash, Eq> is a separate chaining
+ * table that many threads can share:
+ *   - Lookups take no lock and never write shared memory. They run
+ *     inside an EpochGuard (epoch.h), follow atomic chain pointers
+ *     and copy the value out (or hand it to a visitor).
+ *   - Writers lock one of LOCK_STRIPES mutexes, chosen by bucket, so
+ *     writers to different stripes proceed in parallel.
+ *   - Nodes are never modified once published. A replaced or erased
+ *     node is unlinked and retired; the epoch domain frees it once no
+ *     reader can still be looking at it.
+ *   - Growing takes every stripe, copies the chains into a table
+ *     about twice as large and publishes it with one atomic store.
+ *     Readers keep using whichever table they loaded, and the old
+ *     table and its nodes are retired like any other node.
+ ****************************************************************/
+
+#ifndef CONCURRENTMAP_H
+#define CONCURRENTMAP_H
+
+#include <atomic>       // published table and chain pointers
+#include <mutex>        // striped writer locks
+#include <functional>   // std::hash and std::equal_to defaults
+#include <utility>      // std::move
+#include "epoch.h"      // safe reclamation of unlinked nodes
+#include "hashmap.h"    // MAX_LOAD_FACTOR
+
+#define LOCK_STRIPES 64     // writer locks, bucket i is guarded by stripe i % LOCK_STRIPES
+
+/*******************************************************
+ * ConcurrentHashMap class contents by section:
+ * 1. ConcurrentHashMap private types and data members
+ * 2. ConcurrentHashMap private helper prototypes
+ * 3. ConcurrentHashMap constructor/destructor prototypes
+ * 4. ConcurrentHashMap class method prototypes
+ *******************************************************/
+template <class Key, class Value, class Hash = std::hash<Key>, class Eq = std::equal_to<Key>>
+class ConcurrentHashMap {
+private:
+    // 1.
+    struct Node {
+        const Key key;                                      // never changes once the node is published
+        const Value value;
+        const unsigned long hash;                           // full hash of key
+        std::atomic<Node *> next;                           // next node in the same bucket
+    };
+    struct Table {
+        unsigned long size;                                 // number of buckets
+        std::atomic<Node *> *buckets;                       // chain heads
+    };
+    struct alignas(64) Stripe {                             // one lock per cache line so stripes don't false share
+        std::mutex lock;
+    };
+    std::atomic<Table *> table;                             // the table readers and writers use
+    std::atomic<unsigned long> count;                       // number of entries
+    double maxLoadFactor;                                   // count / size ratio that triggers growth
+    Stripe stripes[LOCK_STRIPES];
+    Hash hasher;
+    Eq equals;
+
+    // 2.
+    static Table *allocTable(unsigned long n);              // allocate n empty buckets
+    static void freeTable(void *t);                         // delete a table and every node in it
+    static void freeNode(void *n);                          // delete one node
+    Table *lockBucket(unsigned long hash, std::unique_lock<std::mutex>& lock);  // lock the stripe of hash's bucket
+    void grow(Table *seen);                                 // replace seen with a larger table
+
+public:
+    // 3.
+    explicit ConcurrentHashMap(unsigned long size, double maxLoadFactor = MAX_LOAD_FACTOR,
+                               const Hash& hash = Hash(), const Eq& eq = Eq());
+    ~ConcurrentHashMap();                                   // must not race with any other call
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    // 4.
+    unsigned long getSize() const;                          // number of buckets right now
+    unsigned long getCount() const;                         // number of entries right now
+    double getLoadFactor() const;
+    bool put(Key key, Value value);                         // insert or replace, true if the key was new
+    template <class K>
+    bool erase(const K& key);                               // remove key, true if it was present
+    template <class K>
+    bool find(const K& key, Value& out) const;              // copy the value out, false if missing
+    template <class K>
+    bool contains(const K& key) const;
+    template <class K, class F>
+    bool visit(const K& key, F f) const;                    // call f(value) in place, false if missing
+};
+
+// ConcurrentHashMap constructor
+template <class Key, class Value, class Hash, class Eq>
+ConcurrentHashMap<Key, Value, Hash, Eq>::ConcurrentHashMap(unsigned long size, double maxLoadFactor,
+                                                           const Hash& hash, const Eq& eq)
+    : hasher(hash), equals(eq){
+    this->table.store(allocTable(size > 0 ? size : 1));
+    this->count.store(0);
+    this->maxLoadFactor = maxLoadFactor > 0 ? maxLoadFactor : MAX_LOAD_FACTOR;
+}
+
+// ConcurrentHashMap destructor
+template <class Key, class Value, class Hash, class Eq>
+ConcurrentHashMap<Key, Value, Hash, Eq>::~ConcurrentHashMap(){
+    freeTable(this->table.load());
+}
+
+// Allocate a table of n empty buckets
+template <class Key, class Value, class Hash, class Eq>
+typename ConcurrentHashMap<Key, Value, Hash, Eq>::Table *ConcurrentHashMap<Key, Value, Hash, Eq>::allocTable(
+        unsigned long n){
+    auto *t = new Table;
+    t->size = n;
+    t->buckets = new std::atomic<Node *>[n];
+    for(unsigned long i = 0; i < n; i++){
+        t->buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+    return t;
+}
+
+// Delete a table along with every node still linked into it
+template <class Key, class Value, class Hash, class Eq>
+void ConcurrentHashMap<Key, Value, Hash, Eq>::freeTable(void *p){
+    auto *t = static_cast<Table *>(p);
+    for(unsigned long i = 0; i < t->size; i++){
+        Node *temp = t->buckets[i].load(std::memory_order_relaxed);
+        while(temp != nullptr){
+            Node *next = temp->next.load(std::memory_order_relaxed);
+            delete temp;
+            temp = next;
+        }
+    }
+    delete[] t->buckets;
+    delete t;
+}
+
+// Delete one node
+template <class Key, class Value, class Hash, class Eq>
+void ConcurrentHashMap<Key, Value, Hash, Eq>::freeNode(void *n){
+    delete static_cast<Node *>(n);
+}
+
+// Lock the stripe guarding hash's bucket, returns the table the lock is valid for
+template <class Key, class Value, class Hash, class Eq>
+typename ConcurrentHashMap<Key, Value, Hash, Eq>::Table *ConcurrentHashMap<Key, Value, Hash, Eq>::lockBucket(
+        unsigned long hash, std::unique_lock<std::mutex>& lock){
+    EpochGuard guard;                                       // t can't be freed between loading it and locking
+    while(true){
+        Table *t = this->table.load(std::memory_order_acquire);
+        lock = std::unique_lock<std::mutex>(this->stripes[hash % t->size % LOCK_STRIPES].lock);
+        if(this->table.load(std::memory_order_acquire) == t){  // no growth slipped in before we got the lock
+            return t;
+        }
+        lock.unlock();
+    }
+}
+
+// Replace the table "seen" by one about twice as large
+template <class Key, class Value, class Hash, class Eq>
+void ConcurrentHashMap<Key, Value, Hash, Eq>::grow(Table *seen){
+    std::unique_lock<std::mutex> locks[LOCK_STRIPES];
+    for(int i = 0; i < LOCK_STRIPES; i++){                  // always in the same order, so growers can't deadlock
+        locks[i] = std::unique_lock<std::mutex>(this->stripes[i].lock);
+    }
+    Table *old = this->table.load(std::memory_order_relaxed);
+    if(old != seen){                                        // another thread already grew it
+        return;
+    }
+    Table *t = allocTable(old->size * 2 + 1);
+    for(unsigned long i = 0; i < old->size; i++){
+        // copy rather than relink: readers may still be walking the old chains
+        for(Node *n = old->buckets[i].load(std::memory_order_relaxed); n != nullptr;
+            n = n->next.load(std::memory_order_relaxed)){
+            std::atomic<Node *>& head = t->buckets[n->hash % t->size];
+            head.store(new Node{n->key, n->value, n->hash, {head.load(std::memory_order_relaxed)}},
+                       std::memory_order_relaxed);
+        }
+    }
+    this->table.store(t, std::memory_order_release);
+    for(std::unique_lock<std::mutex>& lock : locks){        // writers can go on with the new table
+        lock.unlock();
+    }
+    EpochDomain::instance().retire(old, freeTable);
+    EpochDomain::instance().collectIfFull();
+}
+
+// ConcurrentHashMap bucket count getter
+template <class Key, class Value, class Hash, class Eq>
+unsigned long ConcurrentHashMap<Key, Value, Hash, Eq>::getSize() const{
+    EpochGuard guard;                                       // a grower may retire the table we load
+    return this->table.load(std::memory_order_acquire)->size;
+}
+
+// ConcurrentHashMap entry count getter
+template <class Key, class Value, class Hash, class Eq>
+unsigned long ConcurrentHashMap<Key, Value, Hash, Eq>::getCount() const{
+    return this->count.load(std::memory_order_relaxed);
+}
+
+// ConcurrentHashMap load factor getter
+template <class Key, class Value, class Hash, class Eq>
+double ConcurrentHashMap<Key, Value, Hash, Eq>::getLoadFactor() const{
+    EpochGuard guard;
+    return static_cast<double>(this->getCount()) / this->table.load(std::memory_order_acquire)->size;
+}
+
+// Insert key, or replace its value if it is already present
+template <class Key, class Value, class Hash, class Eq>
+bool ConcurrentHashMap<Key, Value, Hash, Eq>::put(Key key, Value value){
+    unsigned long hash = this->hasher(key);
+    Table *t;
+    unsigned long size;
+    bool added = true;
+    {
+        std::unique_lock<std::mutex> lock;
+        t = this->lockBucket(hash, lock);
+        size = t->size;                                     // t may be retired as soon as the lock is released
+        std::atomic<Node *> *link = &t->buckets[hash % t->size];
+        Node *old = link->load(std::memory_order_relaxed);
+        while(old != nullptr && !(old->hash == hash && this->equals(old->key, key))){
+            link = &old->next;
+            old = link->load(std::memory_order_relaxed);
+        }
+        if(old != nullptr){                                 // replace: the new node takes the old one's place
+            link->store(new Node{std::move(key), std::move(value), hash, {old->next.load(std::memory_order_relaxed)}},
+                        std::memory_order_release);
+            EpochDomain::instance().retire(old, freeNode);
+            added = false;
+        }
+        else{                                               // insert at the head of the bucket
+            std::atomic<Node *>& head = t->buckets[hash % t->size];
+            head.store(new Node{std::move(key), std::move(value), hash, {head.load(std::memory_order_relaxed)}},
+                       std::memory_order_release);
+        }
+    }
+    EpochDomain::instance().collectIfFull();                // free retired nodes now that the stripe is unlocked
+    if(added && this->count.fetch_add(1, std::memory_order_relaxed) + 1 > this->maxLoadFactor * size){
+        this->grow(t);                                      // only compared against the current table, never loaded
+    }
+    return added;
+}
+
+// Remove key, returns true if it was present
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+bool ConcurrentHashMap<Key, Value, Hash, Eq>::erase(const K& key){
+    unsigned long hash = this->hasher(key);
+    bool erased = false;
+    {
+        std::unique_lock<std::mutex> lock;
+        Table *t = this->lockBucket(hash, lock);
+        std::atomic<Node *> *link = &t->buckets[hash % t->size];
+        for(Node *n = link->load(std::memory_order_relaxed); n != nullptr; n = link->load(std::memory_order_relaxed)){
+            if(n->hash == hash && this->equals(n->key, key)){
+                link->store(n->next.load(std::memory_order_relaxed), std::memory_order_release);
+                EpochDomain::instance().retire(n, freeNode);    // readers standing on n can still step past it
+                this->count.fetch_sub(1, std::memory_order_relaxed);
+                erased = true;
+                break;
+            }
+            link = &n->next;
+        }
+    }
+    EpochDomain::instance().collectIfFull();                // free retired nodes now that the stripe is unlocked
+    return erased;
+}
+
+// Call f(value) on the entry for key without copying it, returns false if missing
+template <class Key, class Value, class Hash, class Eq>
+template <class K, class F>
+bool ConcurrentHashMap<Key, Value, Hash, Eq>::visit(const K& key, F f) const{
+    unsigned long hash = this->hasher(key);
+    EpochGuard guard;                                       // nothing we load can be freed until we leave
+    Table *t = this->table.load(std::memory_order_acquire);
+    for(Node *n = t->buckets[hash % t->size].load(std::memory_order_acquire); n != nullptr;
+        n = n->next.load(std::memory_order_acquire)){
+        if(n->hash == hash && this->equals(n->key, key)){
+            f(n->value);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copy the value mapped to key into out, returns false if missing
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+bool ConcurrentHashMap<Key, Value, Hash, Eq>::find(const K& key, Value& out) const{
+    return this->visit(key, [&out](const Value& v){ out = v; });
+}
+
+// true if key is present
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+bool ConcurrentHashMap<Key, Value, Hash, Eq>::contains(const K& key) const{
+    return this->visit(key, [](const Value&){});
+}
+
+#endif //CONCURRENTMAP_H
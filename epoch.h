@@ -0,0 +1,205 @@
+/****************************************************************
+ * Epoch based memory reclamation.
+ *
+ * Readers of a lock-free structure wrap every access in an
+ * EpochGuard. A writer that unlinks memory hands it to retire()
+ * instead of deleting it; the memory is only freed once every
+ * reader that was active when it was retired has left its guard,
+ * so a reader can never follow a pointer into freed memory.
+ *
+ * Entering and leaving a guard costs one store each to a slot the
+ * thread owns, so readers never write to shared cache lines.
+ *
+ * retire() only appends to the calling thread's own list: it takes
+ * no lock and runs no deleter, so a writer can call it while holding
+ * its own locks. The writer calls collectIfFull() once those are
+ * released, and the list is freed EPOCH_COLLECT pointers at a time.
+ * What a thread still holds when it exits is handed to the domain
+ * and freed by the next collection on any thread.
+ ****************************************************************/
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>       // epoch counters
+#include <cstdint>
+#include <mutex>        // protects the list exited threads leave behind
+#include <vector>       // retired memory waiting to be freed
+#include <stdexcept>    // too many threads
+
+#define EPOCH_SLOTS 256     // threads that can hold a slot at the same time
+#define EPOCH_COLLECT 64    // retired pointers a thread holds before collectIfFull() frees them
+
+/************************************************
+ * EpochDomain class contents by section:
+ * 1. EpochDomain private types and data members
+ * 2. EpochDomain class method prototypes
+ ************************************************/
+class EpochDomain {
+private:
+    // 1.
+    struct alignas(64) Slot {                               // one cache line per thread
+        std::atomic<uint64_t> epoch{0};                     // epoch seen on entry, 0 while outside any guard
+        std::atomic<bool> used{false};                      // owned by a live thread
+    };
+    struct Retired {
+        void *pointer;                                      // memory to free
+        void (*deleter)(void *);                            // how to free it
+        uint64_t epoch;                                     // global epoch when it was retired
+    };
+    struct ThreadState {                                    // each thread's claim on a slot
+        int slot = -1;
+        int depth = 0;                                      // guards can nest
+        std::vector<Retired> retired;                       // retired by this thread, not yet freed
+        ~ThreadState();
+    };
+    Slot slots[EPOCH_SLOTS];
+    std::atomic<uint64_t> global{1};
+    std::mutex retireLock;
+    std::vector<Retired> retired;                           // left behind by threads that have exited
+
+    static ThreadState& thread();                           // the calling thread's state
+    int claimSlot();                                        // find an unused slot for a new thread
+    uint64_t oldestActive();                                // smallest epoch of any reader inside a guard
+
+public:
+    // 2.
+    static EpochDomain& instance();                         // the process wide domain
+    ~EpochDomain();                                         // frees whatever is still retired at exit
+    void enter();                                           // start a read side critical section
+    void exit();                                            // end it
+    void retire(void *pointer, void (*deleter)(void *));    // free pointer once no reader can still see it
+    void collect();                                         // free everything that is safe to free now
+    void collectIfFull();                                   // collect once this thread holds EPOCH_COLLECT pointers
+};
+
+// Read side guard, for as long as it lives retired memory stays valid
+class EpochGuard {
+public:
+    EpochGuard(){ EpochDomain::instance().enter(); }
+    ~EpochGuard(){ EpochDomain::instance().exit(); }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// The process wide domain
+inline EpochDomain& EpochDomain::instance(){
+    static EpochDomain domain;
+    return domain;
+}
+
+// Free anything still retired, no thread can be reading once statics are destroyed
+inline EpochDomain::~EpochDomain(){
+    for(Retired& r : this->retired){
+        r.deleter(r.pointer);
+    }
+}
+
+// The calling thread's slot and nesting depth
+inline EpochDomain::ThreadState& EpochDomain::thread(){
+    thread_local ThreadState state;
+    return state;
+}
+
+// Give the slot back and hand what is still retired to the domain when the thread exits
+inline EpochDomain::ThreadState::~ThreadState(){
+    if(this->slot < 0 && this->retired.empty()){
+        return;
+    }
+    EpochDomain& d = EpochDomain::instance();
+    if(this->slot >= 0){
+        d.slots[this->slot].epoch.store(0);
+        d.slots[this->slot].used.store(false, std::memory_order_release);
+    }
+    if(!this->retired.empty()){
+        std::lock_guard<std::mutex> lock(d.retireLock);
+        d.retired.insert(d.retired.end(), this->retired.begin(), this->retired.end());
+    }
+}
+
+// Find an unused slot for a thread entering its first guard
+inline int EpochDomain::claimSlot(){
+    for(int i = 0; i < EPOCH_SLOTS; i++){
+        bool expected = false;
+        if(!this->slots[i].used.load(std::memory_order_relaxed) &&
+           this->slots[i].used.compare_exchange_strong(expected, true)){
+            return i;
+        }
+    }
+    throw std::runtime_error("EpochDomain: more than EPOCH_SLOTS threads are reading at once");
+}
+
+// Enter a read side critical section
+inline void EpochDomain::enter(){
+    ThreadState& t = thread();
+    if(t.depth++ > 0){
+        return;                                             // already protected by an outer guard
+    }
+    if(t.slot < 0){
+        t.slot = this->claimSlot();
+    }
+    // seq_cst: the slot must be visible before this thread loads any shared pointer
+    this->slots[t.slot].epoch.store(this->global.load());
+}
+
+// Leave a read side critical section
+inline void EpochDomain::exit(){
+    ThreadState& t = thread();
+    if(--t.depth == 0){
+        this->slots[t.slot].epoch.store(0, std::memory_order_release);
+    }
+}
+
+// Smallest epoch of any thread currently inside a guard (UINT64_MAX if none)
+inline uint64_t EpochDomain::oldestActive(){
+    uint64_t oldest = UINT64_MAX;
+    for(Slot& s : this->slots){
+        uint64_t e = s.epoch.load();
+        if(e != 0 && e < oldest){
+            oldest = e;
+        }
+    }
+    return oldest;
+}
+
+// Retire memory that has already been unlinked from every shared structure (no lock taken, nothing freed)
+inline void EpochDomain::retire(void *pointer, void (*deleter)(void *)){
+    uint64_t epoch = this->global.fetch_add(1);             // readers entering from now on can't reach pointer
+    thread().retired.push_back(Retired{pointer, deleter, epoch});
+}
+
+// Free every pointer retired by this thread or left by an exited one that no active reader can still hold
+inline void EpochDomain::collect(){
+    std::vector<Retired>& mine = thread().retired;
+    std::vector<Retired> ready;
+    uint64_t oldest = this->oldestActive();
+    auto split = [&](std::vector<Retired>& list){           // move what is safe into ready, keep the rest in order
+        std::size_t kept = 0;
+        for(Retired& r : list){
+            if(r.epoch < oldest){                           // every active reader entered after it was retired
+                ready.push_back(r);
+            }
+            else{
+                list[kept++] = r;
+            }
+        }
+        list.resize(kept);
+    };
+    split(mine);
+    {
+        std::lock_guard<std::mutex> lock(this->retireLock);
+        split(this->retired);
+    }
+    for(Retired& r : ready){                                // run deleters outside the lock
+        r.deleter(r.pointer);
+    }
+}
+
+// Collect once this thread has EPOCH_COLLECT pointers waiting, call it with no locks held
+inline void EpochDomain::collectIfFull(){
+    if(thread().retired.size() >= EPOCH_COLLECT){
+        this->collect();
+    }
+}
+
+#endif //EPOCH_H
@@ -0,0 +1,304 @@
+/****************************************************************
+ * Bulk student export to CSV, JSON and binary files.
+ *
+ * exportTable() writes every student of a chained table to a file
+ * descriptor in one of three formats:
+ *   - EXPORT_CSV: a name,id,age,gpa header and one line a student,
+ *     exactly what importer.h reads back
+ *   - EXPORT_JSON: an array of {"name", "id", "age", "gpa"} objects,
+ *     one a line, with names escaped
+ *   - EXPORT_BINARY: BINARY_MAGIC and BinaryStudent records, also
+ *     readable by the importer (students whose name doesn't fit
+ *     a record are skipped and counted)
+ * Numbers go through std::to_chars (GPAs as integer hundredths),
+ * so no locale, stream state or iostream buffering is involved.
+ *
+ * The table's buckets are cut into chunks of about EXPORT_CHUNK
+ * students. Each round, every thread formats one chunk into its
+ * own buffer, then the buffers go out in bucket order with a
+ * single writev(), so the output is identical whatever the thread
+ * count and memory stays at one round of buffers however large the
+ * table is. Only the entry find() sees is written for a key that
+ * was put more than once, so rows counts distinct students. The
+ * descriptor can be a file, a pipe or a socket; exportFile()
+ * opens a path ("-" is stdout) for it.
+ ****************************************************************/
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>    // std::min
+#include <climits>      // IOV_MAX
+#include <cstring>      // strlen
+#include <thread>       // chunks are formatted in parallel
+#include <charconv>     // std::to_chars
+#include <cerrno>
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/uio.h>    // writev, one system call per round of chunks
+#include "student.h"    // Student records and HashMap
+#include "importer.h"   // the binary record format
+
+#define EXPORT_CHUNK 16384      // students formatted into one buffer
+#define EXPORT_PREFETCH 8       // students ahead whose names are prefetched while formatting
+
+enum ExportFormat { EXPORT_CSV, EXPORT_JSON, EXPORT_BINARY };
+
+// What an export wrote
+struct ExportResult {
+    bool written = false;                                   // false if the descriptor failed
+    unsigned long rows = 0;                                 // distinct students written
+    unsigned long skipped = 0;                              // students a binary record can't hold
+    unsigned long bytes = 0;
+};
+
+// The format a path's extension asks for: .csv, .json, anything else binary
+inline ExportFormat exportFormatOf(const std::string& path){
+    auto endsWith = [&path](const char *ext){
+        std::size_t n = strlen(ext);
+        return path.length() >= n && path.compare(path.length() - n, n, ext) == 0;
+    };
+    return endsWith(".csv") ? EXPORT_CSV : endsWith(".json") ? EXPORT_JSON : EXPORT_BINARY;
+}
+
+// Append a number with to_chars
+inline void appendNumber(std::string& out, unsigned long value){
+    char digits[24];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+// Append a GPA with two decimals, rounded to hundredths like a binary record (integer formatting is far cheaper);
+// a negative or NaN GPA is written as 0.00 and a huge one is capped rather than overflowing the cast
+inline void appendGPA(std::string& out, double gpa){
+    gpa = gpa > 0 ? gpa : 0;
+    unsigned long hundredths = static_cast<unsigned long>(gpa < 1e15 ? gpa * 100 + 0.5 : 1e17);
+    char digits[24];
+    char *end = std::to_chars(digits, digits + sizeof(digits) - 3, hundredths / 100).ptr;
+    end[0] = '.';
+    end[1] = static_cast<char>('0' + hundredths / 10 % 10);
+    end[2] = static_cast<char>('0' + hundredths % 10);
+    out.append(digits, end + 3);
+}
+
+// Append str as the inside of a JSON string, escaping quotes, backslashes and control characters
+inline void appendJSONString(std::string& out, std::string_view str){
+    static const char hex[] = "0123456789abcdef";
+    std::size_t clean = 0;                                  // characters since the last escape, appended in one go
+    for(std::size_t i = 0; i < str.length(); i++){
+        unsigned char c = str[i];
+        if(c >= 0x20 && c != '"' && c != '\\'){
+            continue;
+        }
+        out.append(str.data() + clean, i - clean);
+        clean = i + 1;
+        out += '\\';
+        if(c == '"' || c == '\\'){
+            out += static_cast<char>(c);
+        }
+        else{
+            out += "u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    out.append(str.data() + clean, str.length() - clean);
+}
+
+// Append one student in the given format, false if a binary record can't hold it
+inline bool appendStudent(std::string& out, const Student& s, ExportFormat format){
+    if(format == EXPORT_CSV){
+        out += s.getName();
+        out += ',';
+        out += s.getID();
+        out += ',';
+        appendNumber(out, static_cast<unsigned long>(s.getAge()));
+        out += ',';
+        appendGPA(out, s.getGPA());
+        out += '\n';
+    }
+    else if(format == EXPORT_JSON){
+        out += "{\"name\": \"";
+        appendJSONString(out, s.getName());
+        out += "\", \"id\": \"";
+        appendJSONString(out, s.getID());
+        out += "\", \"age\": ";
+        appendNumber(out, static_cast<unsigned long>(s.getAge()));
+        out += ", \"gpa\": ";
+        appendGPA(out, s.getGPA());
+        out += "},\n";
+    }
+    else{
+        BinaryStudent r;
+        if(!packStudent(s, r)){
+            return false;
+        }
+        out.append(reinterpret_cast<const char *>(&r), sizeof(r));
+    }
+    return true;
+}
+
+// Write every buffer with as few writev() calls as the kernel allows
+inline bool writeBuffers(int fd, std::vector<std::string>& buffers){
+    std::vector<iovec> pending;
+    for(std::string& b : buffers){
+        if(!b.empty()){
+            pending.push_back({&b[0], b.size()});
+        }
+    }
+    for(std::size_t first = 0; first < pending.size();){
+        ssize_t n = writev(fd, pending.data() + first, std::min<std::size_t>(pending.size() - first, IOV_MAX));
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            return false;
+        }
+        for(std::size_t left = n; left > 0;){               // skip what was written, a short write may end mid-buffer
+            if(left >= pending[first].iov_len){
+                left -= pending[first++].iov_len;
+            }
+            else{
+                pending[first].iov_base = static_cast<char *>(pending[first].iov_base) + left;
+                pending[first].iov_len -= left;
+                left = 0;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Write every student of table to fd. Each round, thread t formats
+ * chunk (round * threads + t) into buffers[t]; the round is then
+ * written in chunk order with writev.
+ */
+template <class Pool, class Range>
+ExportResult exportTable(HashMap<string, Student, StringHash, StringEq, Pool, Range>& table, ExportFormat format,
+                         int fd, unsigned int threads = 0){
+    ExportResult result;
+    table.finishRehash();                                   // every node reachable through bucket()
+    threads = importThreads(threads);
+    unsigned long size = table.getSize();
+    unsigned long perChunk = table.getCount() > 0 ? size * EXPORT_CHUNK / table.getCount() : size;
+    perChunk = perChunk > 0 ? perChunk : 1;                 // buckets per chunk
+    unsigned long chunks = (size + perChunk - 1) / perChunk;
+    std::vector<std::string> buffers(threads + 1);          // the last one holds the header or footer
+    std::vector<std::vector<const Student *>> chunkStudents(threads);
+    std::vector<unsigned long> rows(threads);
+    std::vector<unsigned long> skipped(threads);
+    bool first = true;                                      // JSON: no comma before the first object
+
+    if(format == EXPORT_CSV){
+        buffers[threads] = "name,id,age,gpa\n";
+    }
+    else if(format == EXPORT_JSON){
+        buffers[threads] = "[\n";
+    }
+    else{
+        buffers[threads].assign(BINARY_MAGIC, 8);
+    }
+    result.bytes += buffers[threads].size();
+    if(!writeBuffers(fd, buffers)){
+        return result;
+    }
+
+    auto format1 = [&](unsigned int t, unsigned long chunk){
+        std::string& out = buffers[t];
+        std::vector<const Student *>& students = chunkStudents[t];
+        unsigned long end = std::min(size, (chunk + 1) * perChunk);
+        students.clear();
+        for(unsigned long i = chunk * perChunk; i < end; i++){
+            for(auto node = table.bucket(i); node != nullptr; node = node->next){
+                auto seen = table.bucket(i);                // skip entries shadowed by a newer one for the same key
+                while(seen != node && (seen->hash != node->hash || seen->key != node->key)){
+                    seen = seen->next;
+                }
+                if(seen == node){
+                    students.push_back(&node->value);
+                }
+            }
+        }
+        for(std::size_t i = 0; i < students.size(); i++){
+            if(i + EXPORT_PREFETCH < students.size()){      // long names live outside the node: a miss apiece otherwise
+                __builtin_prefetch(students[i + EXPORT_PREFETCH]->getName().data());
+            }
+            if(appendStudent(out, *students[i], format)){
+                rows[t]++;
+            }
+            else{
+                skipped[t]++;
+            }
+        }
+    };
+    for(unsigned long round = 0; round * threads < chunks; round++){
+        for(std::string& b : buffers){                     // a thread with no chunk this round writes nothing
+            b.clear();
+        }
+        std::vector<std::thread> workers;
+        for(unsigned int t = 1; t < threads && round * threads + t < chunks; t++){
+            workers.emplace_back(format1, t, round * threads + t);
+        }
+        format1(0, round * threads);
+        for(std::thread& w : workers){
+            w.join();
+        }
+        if(format == EXPORT_JSON){                          // every object ends in ",\n"; move the commas ahead
+            for(unsigned int t = 0; t < threads; t++){
+                std::string& b = buffers[t];
+                if(b.empty()){
+                    continue;
+                }
+                b.resize(b.size() - 2);                     // drop the last object's ",\n"
+                b += '\n';
+                b.insert(0, first ? "" : ",\n");
+                first = false;
+            }
+        }
+        for(const std::string& b : buffers){
+            result.bytes += b.size();
+        }
+        if(!writeBuffers(fd, buffers)){
+            return result;
+        }
+    }
+
+    if(format == EXPORT_JSON){
+        for(std::string& b : buffers){
+            b.clear();
+        }
+        buffers[threads] = "]\n";
+        result.bytes += 2;
+        if(!writeBuffers(fd, buffers)){
+            return result;
+        }
+    }
+    for(unsigned int t = 0; t < threads; t++){
+        result.rows += rows[t];
+        result.skipped += skipped[t];
+    }
+    result.written = true;
+    return result;
+}
+
+// Export table to path in the format its extension asks for, "-" writes CSV to stdout
+template <class Pool, class Range>
+ExportResult exportFile(HashMap<string, Student, StringHash, StringEq, Pool, Range>& table, const std::string& path,
+                        unsigned int threads = 0){
+    if(path == "-"){
+        return exportTable(table, EXPORT_CSV, STDOUT_FILENO, threads);
+    }
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        return ExportResult();
+    }
+    ExportResult r = exportTable(table, exportFormatOf(path), fd, threads);
+    if(close(fd) != 0){
+        r.written = false;
+    }
+    return r;
+}
+
+#endif //EXPORTER_H
@@ -0,0 +1,300 @@
+/****************************************************************
+ * Generic open addressing hash map with SIMD probing.
+ *
+ * FlatHashMap<Key, Value, Hash, Eq> is an alternative engine to
+ * HashMap with the same put/find interface. Entries are kept in
+ * one flat array of slots with a parallel array of one byte per
+ * slot: 0x80 marks an empty slot, otherwise the byte holds 7 bits
+ * of the hash (the "tag"). A lookup loads GROUP_WIDTH control
+ * bytes at once and compares every tag in a single SIMD
+ * instruction, so only slots whose tag matches are ever compared
+ * with Eq.
+ ****************************************************************/
+
+#ifndef FLATHASHMAP_H
+#define FLATHASHMAP_H
+
+#include <cstdint>      // fixed width control bytes
+#include <new>          // placement new into the raw slot array
+#include <utility>      // std::move
+#include <functional>   // std::hash and std::equal_to defaults
+#if defined(__AVX2__)
+#include <immintrin.h>  // 32-wide control byte matching
+#elif defined(__SSE2__)
+#include <emmintrin.h>  // 16-wide control byte matching
+#endif
+
+#if defined(__AVX2__)
+#define GROUP_WIDTH 32  // control bytes compared at once (one AVX2 register)
+#else
+#define GROUP_WIDTH 16  // control bytes compared at once (one SSE2 register or the scalar loop)
+#endif
+
+/*************************************************
+ * FlatHashMap class contents by section:
+ * 1. FlatHashMap slot type
+ * 2. FlatHashMap class private data members
+ * 3. FlatHashMap private helper prototypes
+ * 4. FlatHashMap constructor/destructor prototypes
+ * 5. FlatHashMap class method prototypes
+ *************************************************/
+template <class Key, class Value, class Hash = std::hash<Key>, class Eq = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    // 1.
+    struct Slot {
+        Key key;                                            // the slot's key
+        Value value;                                        // the value mapped to key
+    };
+
+private:
+    // 2.
+    int8_t *ctrl;                                           // one control byte per slot
+    Slot *slots;                                            // raw storage, only slots with a tag are constructed
+    unsigned long capacity;                                 // number of slots (a power of two, at least GROUP_WIDTH)
+    unsigned long count;                                    // number of entries stored
+    Hash hasher;                                            // hash policy
+    Eq equals;                                              // equality policy
+
+    // 3.
+    static uint32_t matchByte(const int8_t *group, int8_t b); // bit i set when group[i] == b
+    static unsigned long mix(unsigned long hash);           // spread the hash bits before splitting them
+    void allocate(unsigned long n);                         // allocate n empty slots
+    void release();                                         // destroy every entry and free the arrays
+    template <class K>
+    Slot *findSlot(unsigned long hash, const K& key) const; // the slot holding key, or nullptr
+    Slot *insertSlot(unsigned long hash, Key&& key, Value&& value); // place an entry without checking the load
+    void rehash(unsigned long newCapacity);                 // move every entry into a larger array
+
+public:
+    // 4.
+    explicit FlatHashMap(unsigned long size, const Hash& hash = Hash(), const Eq& eq = Eq());
+    ~FlatHashMap();                                         // memory management/destructor
+    FlatHashMap(const FlatHashMap&) = delete;               // the table owns its entries, so no copies
+    FlatHashMap& operator=(const FlatHashMap&) = delete;
+
+    // 5.
+    unsigned int getSize() const;                           // get the number of slots
+    unsigned long getCount() const;                         // get the number of entries in the table
+    double getLoadFactor() const;                           // get the current count / capacity ratio
+    unsigned long memoryUsage() const;                      // bytes held by the control bytes and slots
+    Value& put(Key key, Value value);                       // insert a new entry, or replace the value of an existing key
+    template <class K>
+    Value *find(const K& key);                              // returns the value mapped to key or nullptr
+    template <class K>
+    const Value *find(const K& key) const;
+    template <class F>
+    void forEach(F visit) const;                            // call visit(key, value) for every entry
+    template <class F>
+    void forEachSlot(F visit) const;                        // call visit(slot index, key, value) for every entry
+};
+
+// FlatHashMap constructor: enough slots for "size" entries at a 7/8 load
+template <class Key, class Value, class Hash, class Eq>
+FlatHashMap<Key, Value, Hash, Eq>::FlatHashMap(unsigned long size, const Hash& hash, const Eq& eq)
+    : hasher(hash), equals(eq){
+    unsigned long want = size * 8 / 7 + 1;
+    unsigned long n = GROUP_WIDTH;
+    while(n < want){                            // round up to a power of two so probing can mask
+        n *= 2;
+    }
+    this->allocate(n);
+    this->count = 0;
+}
+
+// FlatHashMap destructor
+template <class Key, class Value, class Hash, class Eq>
+FlatHashMap<Key, Value, Hash, Eq>::~FlatHashMap(){
+    this->release();
+}
+
+// Compare GROUP_WIDTH control bytes against b, bit i of the result is set when group[i] == b
+template <class Key, class Value, class Hash, class Eq>
+uint32_t FlatHashMap<Key, Value, Hash, Eq>::matchByte(const int8_t *group, int8_t b){
+#if defined(__AVX2__)
+    __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(group));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_set1_epi8(b))));
+#elif defined(__SSE2__)
+    __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(b))));
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < GROUP_WIDTH; i++){       // portable fallback, one byte at a time
+        mask |= static_cast<uint32_t>(group[i] == b) << i;
+    }
+    return mask;
+#endif
+}
+
+// Weak hashes (DJBX33A on short IDs) leave the top bits poorly mixed, so multiply them together first
+template <class Key, class Value, class Hash, class Eq>
+unsigned long FlatHashMap<Key, Value, Hash, Eq>::mix(unsigned long hash){
+    return hash * 0x9E3779B97F4A7C15UL ^ hash >> 29;
+}
+
+// Allocate n slots, every one of them empty
+template <class Key, class Value, class Hash, class Eq>
+void FlatHashMap<Key, Value, Hash, Eq>::allocate(unsigned long n){
+    this->capacity = n;
+    this->ctrl = new int8_t[n];
+    this->slots = static_cast<Slot *>(::operator new(n * sizeof(Slot)));
+    for(unsigned long i = 0; i < n; i++){
+        this->ctrl[i] = static_cast<int8_t>(0x80);
+    }
+}
+
+// Destroy every entry and free both arrays
+template <class Key, class Value, class Hash, class Eq>
+void FlatHashMap<Key, Value, Hash, Eq>::release(){
+    for(unsigned long i = 0; i < this->capacity; i++){
+        if(this->ctrl[i] >= 0){                 // full slots have the top bit clear
+            this->slots[i].~Slot();
+        }
+    }
+    ::operator delete(this->slots);
+    delete[] this->ctrl;
+}
+
+// Walk key's probe sequence until a slot holding it or a group with an empty slot
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+typename FlatHashMap<Key, Value, Hash, Eq>::Slot *FlatHashMap<Key, Value, Hash, Eq>::findSlot(unsigned long hash,
+                                                                                               const K& key) const{
+    unsigned long mixed = mix(hash);
+    auto tag = static_cast<int8_t>(mixed & 0x7F);
+    unsigned long mask = this->capacity / GROUP_WIDTH - 1;
+    unsigned long group = (mixed >> 7) & mask;
+    for(unsigned long step = 1; step <= mask + 1; step++){
+        const int8_t *g = this->ctrl + group * GROUP_WIDTH;
+        for(uint32_t match = matchByte(g, tag); match != 0; match &= match - 1){
+            Slot *s = &this->slots[group * GROUP_WIDTH + __builtin_ctz(match)];
+            if(this->equals(s->key, key)){
+                return s;
+            }
+        }
+        if(matchByte(g, static_cast<int8_t>(0x80)) != 0){   // an empty slot ends the probe sequence
+            return nullptr;
+        }
+        group = (group + step) & mask;
+    }
+    return nullptr;
+}
+
+// Put an entry into the first empty slot of its probe sequence
+template <class Key, class Value, class Hash, class Eq>
+typename FlatHashMap<Key, Value, Hash, Eq>::Slot *FlatHashMap<Key, Value, Hash, Eq>::insertSlot(unsigned long hash,
+                                                                                                  Key&& key,
+                                                                                                  Value&& value){
+    unsigned long mixed = mix(hash);
+    unsigned long mask = this->capacity / GROUP_WIDTH - 1;
+    unsigned long group = (mixed >> 7) & mask;  // the low 7 bits are the tag
+    for(unsigned long step = 1; ; step++){
+        uint32_t empty = matchByte(this->ctrl + group * GROUP_WIDTH, static_cast<int8_t>(0x80));
+        if(empty != 0){
+            unsigned long i = group * GROUP_WIDTH + __builtin_ctz(empty);
+            this->ctrl[i] = static_cast<int8_t>(mixed & 0x7F);
+            return new (&this->slots[i]) Slot{std::move(key), std::move(value)};
+        }
+        group = (group + step) & mask;          // triangular probing visits every group once
+    }
+}
+
+// Move every entry into a freshly allocated array of newCapacity slots
+template <class Key, class Value, class Hash, class Eq>
+void FlatHashMap<Key, Value, Hash, Eq>::rehash(unsigned long newCapacity){
+    int8_t *oldCtrl = this->ctrl;
+    Slot *oldSlots = this->slots;
+    unsigned long oldCapacity = this->capacity;
+
+    this->allocate(newCapacity);
+    for(unsigned long i = 0; i < oldCapacity; i++){
+        if(oldCtrl[i] >= 0){
+            Slot& s = oldSlots[i];
+            this->insertSlot(this->hasher(s.key), std::move(s.key), std::move(s.value));
+            s.~Slot();
+        }
+    }
+    ::operator delete(oldSlots);
+    delete[] oldCtrl;
+}
+
+// FlatHashMap slot count getter
+template <class Key, class Value, class Hash, class Eq>
+unsigned int FlatHashMap<Key, Value, Hash, Eq>::getSize() const{
+    return this->capacity;
+}
+
+// FlatHashMap entry count getter
+template <class Key, class Value, class Hash, class Eq>
+unsigned long FlatHashMap<Key, Value, Hash, Eq>::getCount() const{
+    return this->count;
+}
+
+// FlatHashMap load factor getter
+template <class Key, class Value, class Hash, class Eq>
+double FlatHashMap<Key, Value, Hash, Eq>::getLoadFactor() const{
+    return static_cast<double>(this->count) / this->capacity;
+}
+
+// Bytes held by the table itself (memory owned by the keys and values, such as long strings, isn't counted)
+template <class Key, class Value, class Hash, class Eq>
+unsigned long FlatHashMap<Key, Value, Hash, Eq>::memoryUsage() const{
+    return this->capacity * (sizeof(int8_t) + sizeof(Slot));
+}
+
+// Method to insert an entry into the FlatHashMap object, a key already present keeps its slot and gets the new value
+// (HashMap keeps both and shadows the older one, so find() returns the newest value in either engine)
+template <class Key, class Value, class Hash, class Eq>
+Value& FlatHashMap<Key, Value, Hash, Eq>::put(Key key, Value value){
+    unsigned long hash = this->hasher(key);
+    Slot *s = this->findSlot(hash, key);
+    if(s != nullptr){
+        s->value = std::move(value);
+        return s->value;
+    }
+    if((this->count + 1) * 8 > this->capacity * 7){ // keep at least 1/8 of the slots empty so probes stay short
+        this->rehash(this->capacity * 2);
+    }
+    s = this->insertSlot(hash, std::move(key), std::move(value));
+    this->count++;
+    return s->value;
+}
+
+// Method to find the value mapped to key, returns nullptr if there isn't one
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+const Value *FlatHashMap<Key, Value, Hash, Eq>::find(const K& key) const{
+    const Slot *s = this->findSlot(this->hasher(key), key);
+    return s != nullptr ? &s->value : nullptr;
+}
+
+// Non-const lookup, shares the const implementation
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+Value *FlatHashMap<Key, Value, Hash, Eq>::find(const K& key){
+    return const_cast<Value *>(static_cast<const FlatHashMap *>(this)->find(key));
+}
+
+// Visit every entry in slot order
+template <class Key, class Value, class Hash, class Eq>
+template <class F>
+void FlatHashMap<Key, Value, Hash, Eq>::forEach(F visit) const{
+    for(unsigned long i = 0; i < this->capacity; i++){
+        if(this->ctrl[i] >= 0){
+            visit(this->slots[i].key, this->slots[i].value);
+        }
+    }
+}
+
+// Visit every entry along with the index of the slot holding it
+template <class Key, class Value, class Hash, class Eq>
+template <class F>
+void FlatHashMap<Key, Value, Hash, Eq>::forEachSlot(F visit) const{
+    for(unsigned long i = 0; i < this->capacity; i++){
+        if(this->ctrl[i] >= 0){
+            visit(i, this->slots[i].key, this->slots[i].value);
+        }
+    }
+}
+
+#endif //FLATHASHMAP_H
@@ -0,0 +1,400 @@
+/****************************************************************
+ * Immutable map over a minimal perfect hash.
+ *
+ * FrozenHashMap<Key, Value, Hash, Eq> is built once, by freeze(),
+ * from a populated HashMap and never changes afterwards. Its n
+ * entries sit in one contiguous array, placed by a minimal perfect
+ * hash of their keys (a PTHash-style construction), so a lookup is
+ * exactly one probe into that array and one key compare: there are
+ * no chains, no empty slots and no per-entry pointers or hashes.
+ *
+ * The hash works in three steps:
+ *   - the key's hash picks a partition of about FROZEN_PARTITION
+ *     keys (each partition is an independent perfect hash, which is
+ *     what lets freeze() build them on every core at once)
+ *   - inside the partition, the hash remixed with the partition's
+ *     seed picks a bucket of about FROZEN_BUCKET_KEYS keys, and the
+ *     bucket's 16-bit pilot picks the key's slot among the
+ *     partition's n / FROZEN_LOAD slots
+ *   - the few slots past n are remapped onto the free slots below
+ *     n, so every partition fills its slice of the array exactly
+ * The build places the largest buckets first and tries pilots in
+ * order until every key of the bucket lands on a free slot. A
+ * partition whose pilots overflow is retried with another seed.
+ *
+ * Duplicate keys keep the entry find() saw in the source table.
+ * Keys that aren't in the map still land on some entry; the key
+ * compare rejects them.
+ ****************************************************************/
+
+#ifndef FROZENMAP_H
+#define FROZENMAP_H
+
+#include <cstdint>
+#include <vector>
+#include <thread>       // partitions are built in parallel
+#include <atomic>       // hands out partitions to the building threads
+#include <algorithm>    // stable_sort while removing duplicate keys
+#include "hashmap.h"    // the table being frozen
+#include "hashfunctions.h"  // foldMultiply and FastRange
+
+#define FROZEN_PARTITION 2048   // average keys a partition (its slot bitmap stays in L1 while it is built)
+#define FROZEN_BUCKET_KEYS 4    // average keys a pilot, about 4 bits of pilot per key
+#define FROZEN_LOAD 0.97        // keys per slot while placing, the rest of the slots get remapped
+#define FROZEN_MAX_PILOT 65535  // pilots are 16 bits
+#define FROZEN_ATTEMPTS 16      // seeds a partition tries before freeze() gives up
+#define FROZEN_PREFETCH 8       // nodes ahead prefetched while hashing and copying out of the table
+
+/*************************************************
+ * FrozenHashMap class contents by section:
+ * 1. FrozenHashMap entry and partition types
+ * 2. FrozenHashMap class private data members
+ * 3. FrozenHashMap private helper prototypes
+ * 4. FrozenHashMap constructor prototype
+ * 5. FrozenHashMap class method prototypes
+ *************************************************/
+template <class Key, class Value, class Hash = WyHash, class Eq = std::equal_to<Key>>
+class FrozenHashMap {
+public:
+    // 1.
+    struct Entry {
+        Key key;
+        Value value;
+    };
+
+private:
+    struct Partition {
+        unsigned long offset;                               // index of the partition's first entry
+        unsigned long pilots;                               // index of its first pilot
+        unsigned long remap;                                // index of its first remapped slot
+        uint32_t keys;                                      // entries in the partition
+        uint32_t slots;                                     // keys / FROZEN_LOAD, slots >= keys go through remap
+        uint32_t buckets;                                   // pilots in the partition
+        uint32_t seed;                                      // which attempt succeeded
+    };
+    struct Placed {                                         // what building one partition produced
+        std::vector<uint16_t> pilots;
+        std::vector<uint32_t> remap;
+        std::vector<unsigned long> sources;                 // the source entry of every slot
+    };
+
+    // 2.
+    std::vector<Entry> entries;                             // every entry, partition by partition, in slot order
+    std::vector<uint16_t> pilots;                           // every partition's pilots
+    std::vector<uint32_t> remap;                            // slot - keys -> free slot below keys, per partition
+    std::vector<Partition> partitions;
+    Hash hasher;
+    Eq equals;
+
+    // 3.
+    static uint64_t remix(uint64_t hash, uint32_t seed);   // the hash a partition buckets and places by
+    static uint32_t slotOf(uint64_t mixed, uint16_t pilot, uint32_t slots);
+    template <class Same>
+    static bool place(std::vector<std::pair<uint64_t, unsigned long>>& keys, Same same, Partition& p, Placed& out);
+
+public:
+    // 4.
+    explicit FrozenHashMap(const Hash& hash = Hash(), const Eq& eq = Eq());
+
+    // 5.
+    template <class H, class E, class Pool, class Range>
+    bool freeze(HashMap<Key, Value, H, E, Pool, Range>& table, unsigned int threads = 0);  // copy table, false on failure
+    template <class K>
+    const Value *find(const K& key) const;                  // the value mapped to key or nullptr, one probe
+    unsigned long getCount() const;                         // number of entries
+    unsigned long getPartitions() const;                    // number of independent perfect hashes
+    unsigned long memoryUsage() const;                      // bytes held by the entries, pilots and partitions
+    template <class F>
+    void forEach(F visit) const;                            // call visit(key, value) for every entry
+};
+
+// Empty map, find() answers nullptr until freeze()
+template <class Key, class Value, class Hash, class Eq>
+FrozenHashMap<Key, Value, Hash, Eq>::FrozenHashMap(const Hash& hash, const Eq& eq) : hasher(hash), equals(eq){}
+
+// Remix a key's hash for one partition: independent of the high bits that chose the partition
+template <class Key, class Value, class Hash, class Eq>
+inline uint64_t FrozenHashMap<Key, Value, Hash, Eq>::remix(uint64_t hash, uint32_t seed){
+    return foldMultiply(hash ^ (0xA0761D6478BD642FULL + seed), 0xE7037ED1A0B428DBULL);
+}
+
+// Slot of a key (by its remixed hash) under a pilot
+template <class Key, class Value, class Hash, class Eq>
+inline uint32_t FrozenHashMap<Key, Value, Hash, Eq>::slotOf(uint64_t mixed, uint16_t pilot, uint32_t slots){
+    uint64_t h = foldMultiply(mixed ^ (pilot * 0x9E3779B97F4A7C15ULL), 0x8EBC6AF09C88C6E3ULL);
+    return static_cast<uint32_t>(FastRange::bucket(h, slots));
+}
+
+/*
+ * Build one partition's perfect hash. keys holds the hash and source
+ * index of every key in the partition, newest duplicate first, and
+ * same(i, j) compares the keys of two sources; p gets the sizes and
+ * the seed that worked. False if FROZEN_ATTEMPTS seeds all ran out
+ * of pilots (or two different keys share a full hash).
+ */
+template <class Key, class Value, class Hash, class Eq>
+template <class Same>
+bool FrozenHashMap<Key, Value, Hash, Eq>::place(std::vector<std::pair<uint64_t, unsigned long>>& keys, Same same,
+                                                Partition& p, Placed& out){
+    std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+    std::size_t kept = 0;
+    for(std::size_t i = 0; i < keys.size(); i++){           // equal keys have equal hashes, so they are neighbours now
+        bool duplicate = false;
+        for(std::size_t j = kept; j-- > 0 && keys[j].first == keys[i].first;){
+            duplicate = duplicate || same(keys[j].second, keys[i].second);
+        }
+        if(!duplicate){
+            keys[kept++] = keys[i];
+        }
+    }
+    keys.resize(kept);
+    uint32_t n = static_cast<uint32_t>(kept);
+    p.keys = n;
+    p.slots = n == 0 ? 0 : std::max<uint32_t>(n, static_cast<uint32_t>(n / FROZEN_LOAD));
+    p.buckets = (n + FROZEN_BUCKET_KEYS - 1) / FROZEN_BUCKET_KEYS;
+
+    std::vector<uint32_t> start(p.buckets + 1);             // keys of bucket b: order[start[b], start[b + 1])
+    std::vector<uint32_t> order(n);
+    std::vector<uint64_t> mixed(n);
+    std::vector<uint32_t> buckets(p.buckets);               // bucket numbers, largest first
+    std::vector<uint64_t> taken((p.slots + 63) / 64);
+    std::vector<uint32_t> slots;                            // slots of the bucket being placed
+    std::vector<uint32_t> slotOfKey(n);
+    for(p.seed = 0; p.seed < FROZEN_ATTEMPTS; p.seed++){
+        std::fill(start.begin(), start.end(), 0);
+        for(uint32_t i = 0; i < n; i++){
+            mixed[i] = remix(keys[i].first, p.seed);
+            start[FastRange::bucket(mixed[i], p.buckets) + 1]++;
+        }
+        uint32_t largest = 0;
+        for(uint32_t b = 0; b < p.buckets; b++){
+            largest = std::max(largest, start[b + 1]);
+            start[b + 1] += start[b];
+        }
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for(uint32_t i = 0; i < n; i++){
+            order[fill[FastRange::bucket(mixed[i], p.buckets)]++] = i;
+        }
+        std::vector<uint32_t> bySize(largest + 2);          // counting sort of the buckets, largest first
+        for(uint32_t b = 0; b < p.buckets; b++){
+            bySize[largest - (start[b + 1] - start[b]) + 1]++;
+        }
+        for(uint32_t s = 0; s <= largest; s++){
+            bySize[s + 1] += bySize[s];
+        }
+        for(uint32_t b = 0; b < p.buckets; b++){
+            buckets[bySize[largest - (start[b + 1] - start[b])]++] = b;
+        }
+
+        std::fill(taken.begin(), taken.end(), 0);
+        out.pilots.assign(p.buckets, 0);
+        bool placed = true;
+        for(uint32_t b : buckets){
+            uint32_t first = start[b];
+            uint32_t size = start[b + 1] - first;
+            if(size == 0){
+                break;                                      // the rest are empty too
+            }
+            uint32_t pilot = 0;
+            for(; pilot <= FROZEN_MAX_PILOT; pilot++){
+                slots.clear();
+                for(uint32_t k = 0; k < size; k++){
+                    uint32_t slot = slotOf(mixed[order[first + k]], pilot, p.slots);
+                    if((taken[slot >> 6] >> (slot & 63)) & 1 ||
+                       std::find(slots.begin(), slots.end(), slot) != slots.end()){
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if(slots.size() == size){
+                    break;
+                }
+            }
+            if(pilot > FROZEN_MAX_PILOT){
+                placed = false;
+                break;
+            }
+            out.pilots[b] = static_cast<uint16_t>(pilot);
+            for(uint32_t k = 0; k < size; k++){
+                taken[slots[k] >> 6] |= 1ULL << (slots[k] & 63);
+                slotOfKey[order[first + k]] = slots[k];
+            }
+        }
+        if(!placed){
+            continue;
+        }
+
+        out.remap.assign(p.slots - n, 0);                   // hand the slots past n the free slots below n, in order
+        uint32_t open = 0;
+        for(uint32_t slot = n; slot < p.slots; slot++){
+            if((taken[slot >> 6] >> (slot & 63)) & 1){
+                while((taken[open >> 6] >> (open & 63)) & 1){
+                    open++;
+                }
+                out.remap[slot - n] = open++;
+            }
+        }
+        out.sources.assign(n, 0);
+        for(uint32_t i = 0; i < n; i++){
+            uint32_t slot = slotOfKey[i];
+            out.sources[slot < n ? slot : out.remap[slot - n]] = keys[i].second;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Replace the map's contents with a copy of table. Keys are hashed
+ * on every thread and split into partitions, every thread builds
+ * whole partitions taken from a shared counter, then the entries
+ * are copied from the table's nodes into their slots, again a
+ * partition at a time. table is left as it was (apart from
+ * finishing a pending rehash). On failure the map is unchanged.
+ */
+template <class Key, class Value, class Hash, class Eq>
+template <class H, class E, class Pool, class Range>
+bool FrozenHashMap<Key, Value, Hash, Eq>::freeze(HashMap<Key, Value, H, E, Pool, Range>& table, unsigned int threads){
+    table.finishRehash();
+    if(threads == 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<const typename HashMap<Key, Value, H, E, Pool, Range>::Node *> nodes;  // newest duplicate first
+    nodes.reserve(table.getCount());
+    for(unsigned long i = 0; i < table.getSize(); i++){
+        for(auto node = table.bucket(i); node != nullptr; node = node->next){
+            nodes.push_back(node);
+        }
+    }
+    std::atomic<unsigned long> next{0};
+    auto run = [threads, &next](auto work){
+        next = 0;
+        std::vector<std::thread> workers;
+        for(unsigned int t = 1; t < threads; t++){
+            workers.emplace_back(work);
+        }
+        work();                                             // the calling thread works too
+        for(std::thread& w : workers){
+            w.join();
+        }
+    };
+    std::vector<uint64_t> hashes(nodes.size());
+    unsigned long ranges = threads * 4UL;
+    run([&](){
+        for(unsigned long r = next++; r < ranges; r = next++){
+            unsigned long end = nodes.size() * (r + 1) / ranges;
+            for(unsigned long i = nodes.size() * r / ranges; i < end; i++){
+                if(i + FROZEN_PREFETCH < end){              // bucket order is not allocation order: a miss a node
+                    __builtin_prefetch(nodes[i + FROZEN_PREFETCH]);
+                }
+                hashes[i] = this->hasher(nodes[i]->key);
+            }
+        }
+    });
+    unsigned long parts = std::max(1UL, nodes.size() / FROZEN_PARTITION);
+    std::vector<std::vector<std::pair<uint64_t, unsigned long>>> keys(parts);
+    for(unsigned long i = 0; i < nodes.size(); i++){
+        keys[FastRange::bucket(hashes[i], parts)].emplace_back(hashes[i], i);
+    }
+    auto same = [this, &nodes](unsigned long a, unsigned long b){ return this->equals(nodes[a]->key, nodes[b]->key); };
+
+    std::vector<Partition> built(parts);
+    std::vector<Placed> placed(parts);
+    std::atomic<bool> failed{false};
+    run([&](){
+        for(unsigned long p = next++; p < parts && !failed; p = next++){
+            if(!place(keys[p], same, built[p], placed[p])){
+                failed = true;
+            }
+        }
+    });
+    if(failed){
+        return false;
+    }
+
+    unsigned long offset = 0;
+    unsigned long pilotCount = 0;
+    unsigned long remapCount = 0;
+    for(Partition& p : built){
+        p.offset = offset;
+        p.pilots = pilotCount;
+        p.remap = remapCount;
+        offset += p.keys;
+        pilotCount += p.buckets;
+        remapCount += p.slots - p.keys;
+    }
+    std::vector<Entry> entries(offset);
+    std::vector<uint16_t> pilots(pilotCount);
+    std::vector<uint32_t> remap(remapCount);
+    run([&](){
+        for(unsigned long p = next++; p < parts; p = next++){
+            const Partition& part = built[p];
+            std::copy(placed[p].pilots.begin(), placed[p].pilots.end(), pilots.begin() + part.pilots);
+            std::copy(placed[p].remap.begin(), placed[p].remap.end(), remap.begin() + part.remap);
+            for(uint32_t i = 0; i < part.keys; i++){
+                if(i + FROZEN_PREFETCH < part.keys){
+                    __builtin_prefetch(nodes[placed[p].sources[i + FROZEN_PREFETCH]]);
+                }
+                const auto node = nodes[placed[p].sources[i]];
+                entries[part.offset + i] = Entry{node->key, node->value};
+            }
+        }
+    });
+    this->entries = std::move(entries);
+    this->pilots = std::move(pilots);
+    this->remap = std::move(remap);
+    this->partitions = std::move(built);
+    return true;
+}
+
+// Find key's only possible slot and compare the key stored there
+template <class Key, class Value, class Hash, class Eq>
+template <class K>
+const Value *FrozenHashMap<Key, Value, Hash, Eq>::find(const K& key) const{
+    if(this->partitions.empty()){
+        return nullptr;
+    }
+    uint64_t hash = this->hasher(key);
+    const Partition& p = this->partitions[FastRange::bucket(hash, this->partitions.size())];
+    if(p.keys == 0){
+        return nullptr;
+    }
+    uint64_t mixed = remix(hash, p.seed);
+    uint32_t slot = slotOf(mixed, this->pilots[p.pilots + FastRange::bucket(mixed, p.buckets)], p.slots);
+    if(slot >= p.keys){
+        slot = this->remap[p.remap + slot - p.keys];
+    }
+    const Entry& e = this->entries[p.offset + slot];
+    return this->equals(e.key, key) ? &e.value : nullptr;
+}
+
+// Number of entries
+template <class Key, class Value, class Hash, class Eq>
+unsigned long FrozenHashMap<Key, Value, Hash, Eq>::getCount() const{
+    return this->entries.size();
+}
+
+// Number of partitions, each an independent perfect hash
+template <class Key, class Value, class Hash, class Eq>
+unsigned long FrozenHashMap<Key, Value, Hash, Eq>::getPartitions() const{
+    return this->partitions.size();
+}
+
+// Bytes held by the entry array, the pilots, the remap table and the partitions (like HashMap::memoryUsage, not
+// counting what the keys and values allocate themselves)
+template <class Key, class Value, class Hash, class Eq>
+unsigned long FrozenHashMap<Key, Value, Hash, Eq>::memoryUsage() const{
+    return this->entries.capacity() * sizeof(Entry) + this->pilots.capacity() * sizeof(uint16_t) +
+           this->remap.capacity() * sizeof(uint32_t) + this->partitions.capacity() * sizeof(Partition);
+}
+
+// Call visit(key, value) for every entry, in slot order
+template <class Key, class Value, class Hash, class Eq>
+template <class F>
+void FrozenHashMap<Key, Value, Hash, Eq>::forEach(F visit) const{
+    for(const Entry& e : this->entries){
+        visit(e.key, e.value);
+    }
+}
+
+#endif //FROZENMAP_H
@@ -0,0 +1,221 @@
+/****************************************************************
+ * Seeded synthetic Student generator.
+ *
+ * Every field of the i-th generated student is a pure function of
+ * (seed, i): a SplitMix64 step over the two is hashed into the
+ * name, age and GPA, and the ID is i pushed through a seeded
+ * permutation of the 9-digit range, so
+ *   - the same seed always produces the same population,
+ *   - IDs never repeat (for the first 10^9 students of a seed),
+ *   - a bulk load can be split across threads that each fill their
+ *     own slice of the output and never share any state, and the
+ *     result doesn't depend on how many threads there were.
+ * IDs are written digit pairs at a time straight into the string.
+ ****************************************************************/
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>       // parallel bulk generation
+#include "student.h"    // the records being generated
+
+#define ID_RANGE 1000000000ULL  // 9 free digits after the leading 9, so 10^9 unique IDs per seed
+
+/**************************************************
+ * StudentGenerator class contents by section:
+ * 1. StudentGenerator class private data members
+ * 2. StudentGenerator private helper prototypes
+ * 3. StudentGenerator constructor prototype
+ * 4. StudentGenerator class method prototypes
+ **************************************************/
+class StudentGenerator {
+private:
+    // 1.
+    uint64_t seed;
+    uint64_t next;                                          // index of the next student handed out one at a time
+
+    // 2.
+    static uint64_t splitMix(uint64_t x);                   // one SplitMix64 output for state x
+    static const std::vector<string>& names();              // every "First Last" combination, built once
+    uint64_t permute(uint64_t i) const;                     // seeded bijection of [0, ID_RANGE)
+    template <class F>
+    static void parallel(unsigned long n, unsigned int threads, F fill);    // fill(begin, end) on each thread's slice
+
+public:
+    // 3.
+    explicit StudentGenerator(uint64_t seed = 42);
+
+    // 4.
+    void reseed(uint64_t seed);                             // start over with a different population
+    uint64_t getSeed() const;                               // the seed of the current population
+    string id(uint64_t i) const;                            // the i-th unique 10-digit ID
+    Student student(uint64_t i) const;                      // the i-th student
+    string nextID();                                        // next unique ID on demand
+    Student nextStudent();                                  // next student on demand
+    void generate(unsigned long n, std::vector<Student>& out,
+                  unsigned int threads = 0);                // append the next n students (0 threads = every core)
+    void generateIDs(unsigned long n, std::vector<string>& out,
+                     unsigned int threads = 0);             // append the next n IDs alone
+};
+
+// StudentGenerator constructor
+inline StudentGenerator::StudentGenerator(uint64_t seed){
+    this->reseed(seed);
+}
+
+// Start the sequence over from a new seed
+inline void StudentGenerator::reseed(uint64_t seed){
+    this->seed = seed;
+    this->next = 0;
+}
+
+// StudentGenerator seed getter
+inline uint64_t StudentGenerator::getSeed() const{
+    return this->seed;
+}
+
+// SplitMix64: a golden ratio step followed by a strong 64-bit finalizer
+inline uint64_t StudentGenerator::splitMix(uint64_t x){
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Every "First Last" combination, so generating a name is one string copy
+inline const std::vector<string>& StudentGenerator::names(){
+    static const std::vector<string> all = []{
+        const char *first[] = {"Brigitte", "Stephanie", "Jennifer", "Yolanda", "Ju", "Fen", "Min",
+                               "Nora", "Aria", "Nova", "Jade", "Leilani", "Samantha", "Sage",
+                               "Rachel", "Sutton", "Harlow", "Gia", "Amina", "Ariel", "Samara",
+                               "Alekzandr", "Rusty", "James", "Fei-hung", "Juan", "Gil",
+                               "Charles", "Devin", "Lucas", "Mason", "Logan", "Jackson",
+                               "Samuel", "Mateo", "Owen", "Bastian", "Maverick", "Everett",
+                               "Kai", "Titan", "Rex"};
+        const char *last[] = {"Dillard", "Smith", "Chi", "Li", "Castro", "Brown", "Huang", "Lee",
+                              "Moore", "Lopez", "Gomez", "Wright", "Clark", "Sanchez", "Patel",
+                              "Bryant", "Tran", "Nguyen", "Ali", "Mohammed", "Wang", "Cross",
+                              "Moss", "Quinn", "Rivas", "Chan", "Manning", "Khan", "Parsons",
+                              "Strickland", "Suarez", "Salas", "Cobb", "Moody", "Archer", "Tang",
+                              "Odom", "Hendrix", "Good", "Novak", "Lu", "Branch"};
+        std::vector<string> v;
+        for(const char *f : first){
+            for(const char *l : last){
+                v.push_back(string(f) + " " + l);
+            }
+        }
+        return v;
+    }();
+    return all;
+}
+
+/*
+ * Seeded bijection of [0, 10^9): a 4 round Feistel network over
+ * 30 bits (2^30 > 10^9) is a permutation of [0, 2^30), and walking
+ * the cycle until the value lands back under 10^9 restricts it to a
+ * permutation of [0, 10^9). Fewer than 8% of values need a second step.
+ */
+inline uint64_t StudentGenerator::permute(uint64_t i) const{
+    do{
+        uint64_t left = i >> 15;
+        uint64_t right = i & 0x7FFF;
+        for(uint64_t round = 0; round < 4; round++){
+            uint64_t f = splitMix(this->seed ^ (round << 32) ^ right) & 0x7FFF;
+            uint64_t t = right;
+            right = left ^ f;
+            left = t;
+        }
+        i = left << 15 | right;
+    }while(i >= ID_RANGE);
+    return i;
+}
+
+// The i-th ID: a 9 followed by the permuted index, written two digits at a time
+inline string StudentGenerator::id(uint64_t i) const{
+    static const char pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                "8081828384858687888990919293949596979899";
+    uint64_t v = this->permute(i % ID_RANGE);
+    string s(10, '9');                                      // every student ID starts with a 9
+    char *p = &s[9];
+    p[0] = static_cast<char>('0' + v % 10);                 // odd digit count, the last one goes alone
+    v /= 10;
+    for(p -= 2; p > &s[0]; p -= 2){
+        p[0] = pairs[v % 100 * 2];
+        p[1] = pairs[v % 100 * 2 + 1];
+        v /= 100;
+    }
+    return s;
+}
+
+// The i-th student: name, age (18 - 38) and GPA (2.5 - 4.0) hashed from (seed, i)
+inline Student StudentGenerator::student(uint64_t i) const{
+    const std::vector<string>& all = names();
+    uint64_t r = splitMix(this->seed ^ splitMix(i));
+    uint64_t name = ((r & 0xFFFFFFFF) * all.size()) >> 32; // multiply-shift maps 32 random bits onto the range
+    uint64_t age = (((r >> 32) & 0xFFFF) * 21) >> 16;
+    double gpa = 2.5 + static_cast<double>(r >> 48) / 65536.0 * 1.5;
+    return Student(all[name], this->id(i), 18 + static_cast<int>(age), gpa);
+}
+
+// The next unique ID
+inline string StudentGenerator::nextID(){
+    return this->id(this->next++);
+}
+
+// The next student
+inline Student StudentGenerator::nextStudent(){
+    return this->student(this->next++);
+}
+
+// Split [0, n) into one contiguous slice per thread and run fill(begin, end) on each
+template <class F>
+void StudentGenerator::parallel(unsigned long n, unsigned int threads, F fill){
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads <= 1 || n < 65536){                          // not worth starting threads for
+        fill(0UL, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for(unsigned int t = 0; t < threads; t++){
+        unsigned long begin = n * t / threads;
+        unsigned long end = n * (t + 1) / threads;
+        workers.emplace_back([=]{ fill(begin, end); });
+    }
+    for(std::thread& w : workers){
+        w.join();
+    }
+}
+
+// Append the next n students to out, each thread constructing its own slice in place
+inline void StudentGenerator::generate(unsigned long n, std::vector<Student>& out, unsigned int threads){
+    unsigned long base = out.size();
+    uint64_t first = this->next;
+    out.resize(base + n);
+    parallel(n, threads, [this, &out, base, first](unsigned long begin, unsigned long end){
+        for(unsigned long i = begin; i < end; i++){
+            out[base + i] = this->student(first + i);
+        }
+    });
+    this->next += n;
+}
+
+// Append the next n IDs to out
+inline void StudentGenerator::generateIDs(unsigned long n, std::vector<string>& out, unsigned int threads){
+    unsigned long base = out.size();
+    uint64_t first = this->next;
+    out.resize(base + n);
+    parallel(n, threads, [this, &out, base, first](unsigned long begin, unsigned long end){
+        for(unsigned long i = begin; i < end; i++){
+            out[base + i] = this->id(first + i);
+        }
+    });
+    this->next += n;
+}
+
+#endif //GENERATOR_H
@@ -0,0 +1,172 @@
+/****************************************************************
+ * Hash functions and bucket range reductions.
+ *
+ * Hash policies (all transparent over std::string_view):
+ *   - StringHash (hashmap.h): DJBX33A, byte by byte. Kept for
+ *     compatibility; its high bits barely change across 10-digit
+ *     IDs, so it is only good with a modulo by an odd size.
+ *   - NumericIDHash: parses a 10-digit ID as a number, 8 digits at
+ *     once with SWAR arithmetic on one 64-bit load, and mixes the
+ *     value. Anything that isn't 10 digits goes through WyHash.
+ *   - WyHash: wyhash-style multiply-fold mixer over 8 byte words,
+ *     every output bit depends on every input bit.
+ *
+ * Range policies map a full hash onto [0, size):
+ *   - ModuloRange: hash % size, any hash, one integer division.
+ *   - MaskRange: hash & (size - 1), sizes rounded up to powers of
+ *     two. Uses only the low bits, so the hash must mix them.
+ *   - FastRange: Lemire's multiply-shift (hash * size) >> 64, any
+ *     size. Uses mostly the high bits, so the hash must mix them.
+ * Each also decides how the table grows, since a mask needs every
+ * size to stay a power of two.
+ ****************************************************************/
+
+#ifndef HASHFUNCTIONS_H
+#define HASHFUNCTIONS_H
+
+#include <cstdint>
+#include <cstring>      // memcpy for unaligned word loads
+#include <string>
+#include <string_view>
+
+// Read 8 (or 4) bytes from any address as a little endian word
+inline uint64_t readWord(const char *p){
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint64_t readHalfWord(const char *p){
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// 64x64 -> 128 bit multiply folded back to 64 bits, the core step of wyhash
+inline uint64_t foldMultiply(uint64_t a, uint64_t b){
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+/*
+ * Parse exactly 10 decimal digits. The first 8 are validated and
+ * combined in one register: subtract '0' from every byte, then merge
+ * neighbouring digits into pairs, pairs into fours and fours into
+ * the 8-digit value with three multiplies. Returns false if str
+ * isn't 10 digits long or contains anything but digits.
+ */
+inline bool parseDigits10(std::string_view str, uint64_t& value){
+    if(str.length() != 10){
+        return false;
+    }
+    uint64_t w = readWord(str.data());
+    // a byte is a digit when it is >= '0' and adding 0x46 doesn't carry it past 0x7F ('9' + 0x46 = 0x7F)
+    if(((w - 0x3030303030303030ULL) | (w + 0x4646464646464646ULL)) & 0x8080808080808080ULL){
+        return false;
+    }
+    char c8 = str[8];
+    char c9 = str[9];
+    if(c8 < '0' || c8 > '9' || c9 < '0' || c9 > '9'){
+        return false;
+    }
+    w -= 0x3030303030303030ULL;                             // every byte is now 0 - 9, the first digit in the low byte
+    w = (w * 10 + (w >> 8)) & 0x00FF00FF00FF00FFULL;        // 4 two-digit values
+    w = (w * 100 + (w >> 16)) & 0x0000FFFF0000FFFFULL;      // 2 four-digit values
+    w = (w * 10000 + (w >> 32)) & 0xFFFFFFFFULL;            // the 8-digit value
+    value = w * 100 + static_cast<uint64_t>(c8 - '0') * 10 + static_cast<uint64_t>(c9 - '0');
+    return true;
+}
+
+// wyhash-style hash of any byte string
+inline uint64_t wyHash(std::string_view str, uint64_t seed = 0){
+    const uint64_t s0 = 0xA0761D6478BD642FULL;              // wyhash's default secret
+    const uint64_t s1 = 0xE7037ED1A0B428DBULL;
+    const char *p = str.data();
+    std::size_t len = str.length();
+    uint64_t a;
+    uint64_t b;
+    seed ^= foldMultiply(seed ^ s0, s1);
+    if(len <= 16){
+        if(len >= 4){                                       // two overlapping pairs of 4 byte reads cover 4 - 16 bytes
+            a = readHalfWord(p) << 32 | readHalfWord(p + ((len >> 3) << 2));
+            b = readHalfWord(p + len - 4) << 32 | readHalfWord(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if(len > 0){                                   // first, middle and last byte
+            auto u = reinterpret_cast<const unsigned char *>(p);
+            a = static_cast<uint64_t>(u[0]) << 16 | static_cast<uint64_t>(u[len >> 1]) << 8 | u[len - 1];
+            b = 0;
+        }
+        else{
+            a = 0;
+            b = 0;
+        }
+    }
+    else{
+        std::size_t i = len;
+        for(; i > 16; i -= 16, p += 16){
+            seed = foldMultiply(readWord(p) ^ s1, readWord(p + 8) ^ seed);
+        }
+        a = readWord(p + i - 16);                           // the last 16 bytes, overlapping the loop if need be
+        b = readWord(p + i - 8);
+    }
+    unsigned __int128 r = static_cast<unsigned __int128>(a ^ s1) * (b ^ seed);
+    return foldMultiply(static_cast<uint64_t>(r) ^ s0 ^ len, static_cast<uint64_t>(r >> 64) ^ s1);
+}
+
+// wyhash-style policy for any string key
+struct WyHash {
+    using is_transparent = void;
+    unsigned long operator()(std::string_view s) const { return wyHash(s); }
+    unsigned long operator()(const std::string& s) const { return wyHash(s); }
+    unsigned long operator()(const char *s) const { return wyHash(s); }
+};
+
+/*
+ * Policy for 10-digit numeric IDs: hash the parsed value instead of
+ * the characters. The value goes through two fold multiplies, so
+ * both its low and its high bits are usable by any range policy.
+ */
+struct NumericIDHash {
+    using is_transparent = void;
+    unsigned long operator()(std::string_view s) const {
+        uint64_t value;
+        if(parseDigits10(s, value)){
+            uint64_t h = foldMultiply(value ^ 0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL);
+            return foldMultiply(h, 0x8EBC6AF09C88C6E3ULL);  // a second round so consecutive IDs differ in the high bits too
+        }
+        return wyHash(s);
+    }
+    unsigned long operator()(const std::string& s) const { return (*this)(std::string_view(s)); }
+    unsigned long operator()(const char *s) const { return (*this)(std::string_view(s)); }
+};
+
+// hash % size, the sizes grow as size * 2 + 1 so they stay odd
+struct ModuloRange {
+    static unsigned long fit(unsigned long size){ return size > 0 ? size : 1; }
+    static unsigned long grow(unsigned long size){ return size * 2 + 1; }
+    static unsigned long bucket(unsigned long hash, unsigned long size){ return hash % size; }
+};
+
+// hash & (size - 1), every size is a power of two
+struct MaskRange {
+    static unsigned long fit(unsigned long size){
+        unsigned long p = 1;
+        while(p < size){
+            p <<= 1;
+        }
+        return p;
+    }
+    static unsigned long grow(unsigned long size){ return size * 2; }
+    static unsigned long bucket(unsigned long hash, unsigned long size){ return hash & (size - 1); }
+};
+
+// (hash * size) >> 64, any size, no division
+struct FastRange {
+    static unsigned long fit(unsigned long size){ return size > 0 ? size : 1; }
+    static unsigned long grow(unsigned long size){ return size * 2 + 1; }
+    static unsigned long bucket(unsigned long hash, unsigned long size){
+        return static_cast<unsigned long>((static_cast<unsigned __int128>(hash) * size) >> 64);
+    }
+};
+
+#endif //HASHFUNCTIONS_H
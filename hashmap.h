@@ -0,0 +1,707 @@
+/****************************************************************
+ * Generic separate chaining hash map.
+ *
+ * HashMap<Key, Value, Hash, Eq> maps keys to values through an
+ * array of singly linked chains. Each node keeps the full hash of
+ * its key, so mismatches in a chain are rejected with one integer
+ * compare and the table can be regrown without rehashing keys.
+ *
+ * Lookups are heterogeneous: find() accepts any type that Hash
+ * and Eq can take, so a map keyed by std::string can be searched
+ * with a std::string_view or a const char * without building a
+ * temporary string (see StringHash below).
+ *
+ * The table grows on its own once count exceeds maxLoadFactor *
+ * size. Growing allocates a new table and keeps the old one around
+ * while its buckets are migrated REHASH_STEP at a time by every
+ * following insert and lookup, so no single operation pays for a
+ * full rehash.
+ *
+ * findBatch() and insertBatch() work through BATCH_WINDOW keys at a
+ * time in stages: hash every key, prefetch every bucket head, then
+ * walk all the chains in lockstep, prefetching each next node, so
+ * the cache misses of different keys overlap instead of queueing.
+ *
+ * Node memory comes from a Pool policy (see nodepool.h): HeapPool
+ * allocates every node with new, SlabPool carves them out of large
+ * slabs and frees them all at once when the table is destroyed.
+ *
+ * A Range policy (see hashfunctions.h) maps hashes onto buckets and
+ * picks the table sizes: ModuloRange (the default) is hash % size on
+ * odd sizes, MaskRange and FastRange avoid the division but need a
+ * hash that mixes its low or high bits, such as WyHash.
+ *
+ * erase() unlinks the newest entry for a key (the one find() sees),
+ * handing its node back to the pool.
+ *
+ * insertPartitioned() loads entries that have already been split by
+ * partitionOf() into disjoint bucket ranges, building each range on
+ * its own thread with no locking at all (when the Pool allows it).
+ *
+ * stats() reports the shape of the table and, when compiled with
+ * HASHMAP_STATS, probe and resize counters (see hashstats.h).
+ ****************************************************************/
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <string>       // string keys
+#include <string_view>  // heterogeneous lookup without temporary strings
+#include <functional>   // std::hash and std::equal_to defaults
+#include <utility>      // std::move
+#include <new>          // placement new into pool memory
+#include <type_traits>  // skip node destructors that do nothing
+#include <vector>       // per-thread buffers of a partitioned load
+#include <thread>       // partitioned loads build disjoint bucket ranges in parallel
+#include <atomic>       // hands out partitions to the building threads
+#include "nodepool.h"   // HeapPool (default) and SlabPool
+#include "hashfunctions.h"  // alternative hash policies and bucket range reductions
+#include "hashstats.h"  // stats() snapshots and the HASHMAP_STATS counters
+
+#define MAX_LOAD_FACTOR 1.0 // default average chain length allowed before the table grows
+#define REHASH_STEP 4   // number of old buckets migrated per operation while the table grows
+#define BATCH_WINDOW 32 // keys whose cache misses are overlapped by findBatch/insertBatch
+
+// DJBX33A algorithm for hashing
+inline unsigned long hashID(std::string_view str){
+    unsigned long hash = 5381;                              // DJBX33A traditional starting point
+    for(char i : str){                                      // run loop until reaching the last character of the ID
+        unsigned long c = static_cast<unsigned char>(i);    // assign the ASCII value of the character stored in i to c
+        hash = hash * 33 + c;                               // DJBX33A hashing algorithm
+    }
+    return hash;                                            // assign this hash value where called
+}
+
+/*
+ * Hash policy for string keys. Every overload hashes through a
+ * string_view, so std::string, std::string_view and const char *
+ * keys all produce the same value and none of them allocate.
+ */
+struct StringHash {
+    using is_transparent = void;                            // marks this policy as usable with non-Key types
+    unsigned long operator()(std::string_view s) const { return hashID(s); }
+    unsigned long operator()(const std::string& s) const { return hashID(s); }
+    unsigned long operator()(const char *s) const { return hashID(s); }
+};
+
+/*
+ * Equality policy for string keys, comparing through string_views
+ * for the same reason as StringHash.
+ */
+struct StringEq {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+};
+
+/*********************************************
+ * HashMap class contents by section:
+ * 1. HashMap node type
+ * 2. HashMap class private data members
+ * 3. HashMap private helper prototypes
+ * 4. HashMap constructor/destructor prototypes
+ * 5. HashMap class method prototypes
+ *********************************************/
+template <class Key, class Value, class Hash = std::hash<Key>, class Eq = std::equal_to<Key>,
+          class Pool = HeapPool, class Range = ModuloRange>
+class HashMap {
+public:
+    // 1.
+    struct Node {
+        Key key;                                            // the node's key
+        Value value;                                        // the value mapped to key
+        unsigned long hash;                                 // full hash of key (reduced to a bucket by Range)
+        Node *next;                                         // next node in the same bucket
+    };
+    struct BulkEntry {                                      // an entry waiting in a partitioned load
+        Key key;
+        Value value;
+        unsigned long hash;                                 // hashKey(key)
+    };
+
+private:
+    // 2.
+    Node **table;                                           // HashMap's array of chain heads (nullptr when empty)
+    unsigned long size;                                     // HashMap's size
+    Node **oldTable;                                        // table being drained while growing (nullptr otherwise)
+    unsigned long oldSize;                                  // size of the table being drained
+    unsigned long migrateIndex;                             // next bucket of oldTable to be migrated
+    unsigned long count;                                    // number of nodes stored in the table
+    double maxLoadFactor;                                   // count / size ratio that triggers growth
+    Hash hasher;                                            // hash policy
+    Eq equals;                                              // equality policy
+    Pool pool;                                              // where the nodes' memory comes from
+    HASHMAP_STAT(mutable HashMapCounters counters;)         // lookups and resizes (counted by const lookups too)
+
+    // 3.
+    static Node **allocTable(unsigned long n);              // allocate a table of n empty buckets
+    void freeChains(Node **t, unsigned long n);             // delete every node of a table
+    void grow();                                            // start migrating into a table about twice as large
+    void migrate(unsigned long steps);                      // move up to "steps" buckets out of oldTable
+    template <class K>
+    Node *findNode(const K& key, unsigned long hash) const; // search both tables without migrating
+    bool heldBefore(const Node *head, const Node *stop, const Node *node) const;   // a node from head to stop has node's key
+
+public:
+    // 4.
+    explicit HashMap(unsigned long size, double maxLoadFactor = MAX_LOAD_FACTOR,
+                     const Hash& hash = Hash(), const Eq& eq = Eq());
+    ~HashMap();                                             // memory management/destructor
+    HashMap(const HashMap&) = delete;                       // the table owns its nodes, so no copies
+    HashMap& operator=(const HashMap&) = delete;
+
+    // 5.
+    unsigned int getSize() const;                           // get the number of buckets
+    unsigned long getCount() const;                         // get the number of entries in the table
+    double getLoadFactor() const;                           // get the current count / size ratio
+    double getMaxLoadFactor() const;                        // get the ratio that triggers growth
+    void setMaxLoadFactor(double lf);                       // set the ratio that triggers growth
+    bool isRehashing() const;                               // true while buckets are still being migrated
+    unsigned long memoryUsage() const;                      // bytes held by the bucket arrays and nodes
+    void finishRehash();                                    // migrate every remaining bucket right away
+    void reserve(unsigned long n);                          // size the table for n entries in one step
+    Value& put(Key key, Value value);                       // insert a new entry at the head of its bucket
+    Value& put(Key key, Value value, unsigned long hash);   // the same with hash already computed by hashKey(key)
+    template <class K>
+    unsigned long hashKey(const K& key) const;              // the hash put() would store for key
+    unsigned long partitionOf(unsigned long hash, unsigned long parts) const;   // which of parts bucket ranges hash is in
+    void insertPartitioned(std::vector<BulkEntry> *buffers, unsigned long producers,
+                           unsigned long parts, unsigned int threads);  // build every partition on its own thread
+    void insertBatch(Key *keys, Value *values, unsigned long n);    // put n entries, moving from both arrays
+    template <class K>
+    void findBatch(const K *keys, unsigned long n, Value **out);    // out[i] = find(keys[i])
+    template <class K>
+    Value *find(const K& key);                              // returns the value mapped to key or nullptr
+    template <class K>
+    const Value *find(const K& key) const;                  // same, but never advances a pending migration
+    template <class K>
+    bool erase(const K& key);                               // remove the newest entry for key, false if there is none
+    const Node *bucket(unsigned long i) const;              // head of bucket i (call finishRehash() first)
+    bool isShadowed(unsigned long i, const Node *node) const;   // a newer node of bucket i has node's key, so find() skips node
+    Pool& getPool();                                        // the node allocator, e.g. to turn on huge pages
+    template <class F>
+    void forEach(F visit) const;                            // call visit(key, value) for every entry
+    template <class F>
+    void forEachNewest(F visit) const;                      // the same, but only for the entry find() returns for each key
+    HashMapStats stats() const;                             // snapshot of the table's shape and counters
+    void resetStats();                                      // zero the counters
+};
+
+// Overloaded HashMap constructor
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+HashMap<Key, Value, Hash, Eq, Pool, Range>::HashMap(unsigned long size, double maxLoadFactor, const Hash& hash, const Eq& eq)
+    : hasher(hash), equals(eq){
+    this->size = Range::fit(size);              // set this hashmap's size to size (at least one bucket)
+    this->table = allocTable(this->size);       // allocate memory for this hashmap's array of chains
+    this->oldTable = nullptr;                   // nothing to migrate yet
+    this->oldSize = 0;
+    this->migrateIndex = 0;
+    this->count = 0;
+    this->maxLoadFactor = maxLoadFactor > 0 ? maxLoadFactor : MAX_LOAD_FACTOR;
+}
+
+// HashMap destructor
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+HashMap<Key, Value, Hash, Eq, Pool, Range>::~HashMap(){
+    freeChains(this->table, this->size);
+    if (this->oldTable != nullptr){             // only set if we were destroyed in the middle of growing
+        freeChains(this->oldTable, this->oldSize);
+    }
+}
+
+// Allocate a table of n buckets, all empty
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+typename HashMap<Key, Value, Hash, Eq, Pool, Range>::Node **HashMap<Key, Value, Hash, Eq, Pool, Range>::allocTable(unsigned long n){
+    return new Node *[n]();                     // value-initialized, so every head starts as nullptr
+}
+
+// Delete every node of a table and then the table itself
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::freeChains(Node **t, unsigned long n){
+    if (!(Pool::bulkRelease && std::is_trivially_destructible<Node>::value)){   // otherwise the pool frees it all later
+        for (unsigned long i = 0; i < n; i++) {
+            Node *temp1 = t[i];                 // create a temporary pointer to the first node in the table's index
+            while(temp1 != nullptr){            // continue until temp1 is a nullptr (migrated buckets are already nullptr)
+                Node *temp2 = temp1;            // create a second temporary pointer to delete while the other traverses the list
+                temp1 = temp1->next;            // traverse the linked list of nodes
+                temp2->~Node();                 // destroy the key and value
+                if (!Pool::bulkRelease){
+                    this->pool.deallocate(temp2, sizeof(Node));     // deallocate the node memory
+                }
+            }
+        }
+    }
+    delete[] t;                                 // deallocate the table memory
+}
+
+// Begin growing: the current table becomes the old table and is drained by migrate()
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::grow(){
+    this->finishRehash();                       // a previous growth may still be in progress
+    HASHMAP_STAT(this->counters.resizes++);
+    this->oldTable = this->table;
+    this->oldSize = this->size;
+    this->migrateIndex = 0;
+    this->size = Range::grow(this->size);       // about twice as large, in a shape the range policy can use
+    this->table = allocTable(this->size);
+}
+
+/*
+ * Move up to "steps" buckets from the old table into the current one.
+ * Nodes are appended at the tail of their new bucket, so a chain keeps
+ * its newest-first order however many times the table grows, and any
+ * entry put() into the new table while the old bucket waited (always
+ * newer) stays ahead of the old ones.
+ */
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::migrate(unsigned long steps){
+    while (this->oldTable != nullptr && steps-- > 0){
+        Node *temp = this->oldTable[this->migrateIndex];
+        while (temp != nullptr){
+            Node *next = temp->next;
+            Node **tail = &this->table[Range::bucket(temp->hash, this->size)];
+            while (*tail != nullptr){           // the new table is about half full, so this is short
+                tail = &(*tail)->next;
+            }
+            temp->next = nullptr;               // relink at the tail of its new bucket
+            *tail = temp;
+            temp = next;
+        }
+        this->oldTable[this->migrateIndex] = nullptr;
+
+        if (++this->migrateIndex == this->oldSize){ // every bucket has moved, release the old table
+            delete[] this->oldTable;
+            this->oldTable = nullptr;
+            this->oldSize = 0;
+            this->migrateIndex = 0;
+        }
+    }
+}
+
+// Search the current table, then any unmigrated old bucket, for key (put() only inserts into the current table, so
+// anything found there is newer than what the old bucket holds)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+typename HashMap<Key, Value, Hash, Eq, Pool, Range>::Node *HashMap<Key, Value, Hash, Eq, Pool, Range>::findNode(const K& key,
+                                                                                      unsigned long hash) const{
+    HASHMAP_STAT(unsigned long probes = 0);
+    for (Node *temp = this->table[Range::bucket(hash, this->size)]; temp != nullptr; temp = temp->next){
+        HASHMAP_STAT(probes++);
+        if (temp->hash == hash && this->equals(temp->key, key)){    // the hash compare rejects almost every mismatch
+            HASHMAP_STAT(this->counters.lookup(true, probes));
+            return temp;
+        }
+    }
+    if (this->oldTable != nullptr){             // the entry may still be in an unmigrated old bucket
+        unsigned long oldValue = Range::bucket(hash, this->oldSize);
+        if (oldValue >= this->migrateIndex){
+            for (Node *old = this->oldTable[oldValue]; old != nullptr; old = old->next){
+                HASHMAP_STAT(probes++);
+                if (old->hash == hash && this->equals(old->key, key)){
+                    HASHMAP_STAT(this->counters.lookup(true, probes));
+                    return old;
+                }
+            }
+        }
+    }
+    HASHMAP_STAT(this->counters.lookup(false, probes));
+    return nullptr;
+}
+
+// Walk the chain from head up to (not including) stop, looking for a node with node's hash and key
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+bool HashMap<Key, Value, Hash, Eq, Pool, Range>::heldBefore(const Node *head, const Node *stop, const Node *node) const{
+    for (const Node *temp = head; temp != stop; temp = temp->next){
+        if (temp->hash == node->hash && this->equals(temp->key, node->key)){
+            return true;
+        }
+    }
+    return false;
+}
+
+// HashMap bucket count getter
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+unsigned int HashMap<Key, Value, Hash, Eq, Pool, Range>::getSize() const{
+    return this->size;
+}
+
+// HashMap entry count getter
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+unsigned long HashMap<Key, Value, Hash, Eq, Pool, Range>::getCount() const{
+    return this->count;
+}
+
+// HashMap load factor getter
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+double HashMap<Key, Value, Hash, Eq, Pool, Range>::getLoadFactor() const{
+    return static_cast<double>(this->count) / this->size;
+}
+
+// HashMap maximum load factor getter
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+double HashMap<Key, Value, Hash, Eq, Pool, Range>::getMaxLoadFactor() const{
+    return this->maxLoadFactor;
+}
+
+// HashMap maximum load factor setter (takes effect on the next insert)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::setMaxLoadFactor(double lf){
+    if (lf > 0){
+        this->maxLoadFactor = lf;
+    }
+}
+
+// true while the old table still has buckets waiting to be migrated
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+bool HashMap<Key, Value, Hash, Eq, Pool, Range>::isRehashing() const{
+    return this->oldTable != nullptr;
+}
+
+// Bytes held by the table itself (memory owned by the keys and values, such as long strings, isn't counted)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+unsigned long HashMap<Key, Value, Hash, Eq, Pool, Range>::memoryUsage() const{
+    unsigned long nodes = this->pool.memoryUsage();         // slab pools know exactly what they have mapped
+    if (nodes == 0){
+        nodes = this->count * sizeof(Node);
+    }
+    return (this->size + this->oldSize) * sizeof(Node *) + nodes;
+}
+
+// Migrate every remaining bucket of a pending growth
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::finishRehash(){
+    this->migrate(this->oldSize);
+}
+
+// Grow straight to a size that holds n entries without further growth (finishes any pending migration)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::reserve(unsigned long n){
+    this->finishRehash();
+    if (n <= this->maxLoadFactor * this->size){
+        return;
+    }
+    unsigned long newSize = this->size;
+    while (n > this->maxLoadFactor * newSize){
+        newSize = Range::grow(newSize);         // same sequence of sizes grow() would have gone through
+    }
+    HASHMAP_STAT(this->counters.resizes++);
+    this->oldTable = this->table;
+    this->oldSize = this->size;
+    this->migrateIndex = 0;
+    this->size = newSize;
+    this->table = allocTable(newSize);
+    this->finishRehash();
+}
+
+// Method to insert an entry into the HashMap object
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+Value& HashMap<Key, Value, Hash, Eq, Pool, Range>::put(Key key, Value value){
+    unsigned long hash = this->hasher(key);                 // before key is moved from
+    return this->put(std::move(key), std::move(value), hash);
+}
+
+// Insert an entry whose hash the caller already has (it must be hashKey(key), or lookups won't find it)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+Value& HashMap<Key, Value, Hash, Eq, Pool, Range>::put(Key key, Value value, unsigned long hash){
+    this->migrate(REHASH_STEP);                             // do a little of any pending growth first
+    Node **head = &this->table[Range::bucket(hash, this->size)];
+    void *memory = this->pool.allocate(sizeof(Node));
+    Node *node = new (memory) Node{std::move(key), std::move(value), hash, *head};  // O(1) no matter how long the chain is
+    *head = node;
+    this->count++;
+
+    if (this->count > this->maxLoadFactor * this->size){    // too many entries per bucket, start growing
+        this->grow();
+    }
+    return node->value;
+}
+
+// The hash put() would store for key
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+unsigned long HashMap<Key, Value, Hash, Eq, Pool, Range>::hashKey(const K& key) const{
+    return this->hasher(key);
+}
+
+// Which of parts equal ranges of buckets hash falls into (only holds until the table next grows, so reserve() first)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+unsigned long HashMap<Key, Value, Hash, Eq, Pool, Range>::partitionOf(unsigned long hash, unsigned long parts) const{
+    return static_cast<unsigned long>(static_cast<unsigned __int128>(Range::bucket(hash, this->size)) * parts /
+                                      this->size);
+}
+
+/*
+ * Move every entry of buffers[t * parts + p] (for each of the producers t)
+ * into the table. Every entry of partition p must have been routed there by
+ * partitionOf() since the last reserve(), so no two threads ever touch the
+ * same bucket; the threads take whole partitions at a time and take the
+ * producers in order, so of two entries with the same key the later one
+ * ends up first in its chain, as with put(). Pools that aren't thread safe
+ * get a single builder thread.
+ */
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::insertPartitioned(std::vector<BulkEntry> *buffers,
+                                                                  unsigned long producers, unsigned long parts,
+                                                                  unsigned int threads){
+    this->finishRehash();
+    unsigned long total = 0;
+    for (unsigned long i = 0; i < producers * parts; i++){
+        total += buffers[i].size();
+    }
+    if (!Pool::threadSafe || threads == 0){
+        threads = 1;
+    }
+    std::atomic<unsigned long> next{0};
+    auto build = [&](){
+        for (unsigned long p = next++; p < parts; p = next++){
+            for (unsigned long t = 0; t < producers; t++){
+                for (BulkEntry& e : buffers[t * parts + p]){
+                    Node **head = &this->table[Range::bucket(e.hash, this->size)];
+                    void *memory = this->pool.allocate(sizeof(Node));
+                    *head = new (memory) Node{std::move(e.key), std::move(e.value), e.hash, *head};
+                }
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++){
+        workers.emplace_back(build);
+    }
+    build();                                    // the calling thread builds too
+    for (std::thread& w : workers){
+        w.join();
+    }
+    this->count += total;
+    if (this->count > this->maxLoadFactor * this->size){    // more than was reserved for, grow as put() would
+        this->grow();
+    }
+}
+
+// Method to find the value mapped to key, returns nullptr if there isn't one
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+Value *HashMap<Key, Value, Hash, Eq, Pool, Range>::find(const K& key){
+    this->migrate(REHASH_STEP);                             // do a little of any pending growth first
+    Node *node = this->findNode(key, this->hasher(key));
+    return node != nullptr ? &node->value : nullptr;
+}
+
+// Insert n entries, overlapping the bucket head misses of BATCH_WINDOW keys at a time
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::insertBatch(Key *keys, Value *values, unsigned long n){
+    this->reserve(this->count + n);             // no growth can start in the middle of the batch
+    unsigned long hashes[BATCH_WINDOW];
+    for (unsigned long base = 0; base < n; base += BATCH_WINDOW){
+        unsigned long w = n - base < BATCH_WINDOW ? n - base : BATCH_WINDOW;
+        for (unsigned long i = 0; i < w; i++){  // stage 1: hash and prefetch every bucket head for writing
+            hashes[i] = this->hasher(keys[base + i]);
+            __builtin_prefetch(&this->table[Range::bucket(hashes[i], this->size)], 1);
+        }
+        for (unsigned long i = 0; i < w; i++){  // stage 2: the heads should be in cache by now
+            Node **head = &this->table[Range::bucket(hashes[i], this->size)];
+            void *memory = this->pool.allocate(sizeof(Node));
+            *head = new (memory) Node{std::move(keys[base + i]), std::move(values[base + i]), hashes[i], *head};
+        }
+    }
+    this->count += n;
+}
+
+// Look up n keys, out[i] is set to the value of keys[i] or nullptr
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::findBatch(const K *keys, unsigned long n, Value **out){
+    this->migrate(REHASH_STEP * n);             // the same amount of migration n single lookups would do
+    unsigned long hashes[BATCH_WINDOW];
+    Node *cursor[BATCH_WINDOW];
+    HASHMAP_STAT(unsigned long probes[BATCH_WINDOW];)
+    for (unsigned long base = 0; base < n; base += BATCH_WINDOW){
+        unsigned long w = n - base < BATCH_WINDOW ? n - base : BATCH_WINDOW;
+        for (unsigned long i = 0; i < w; i++){  // stage 1: hash and prefetch every bucket head
+            hashes[i] = this->hasher(keys[base + i]);
+            __builtin_prefetch(&this->table[Range::bucket(hashes[i], this->size)]);
+        }
+        for (unsigned long i = 0; i < w; i++){  // stage 2: load the heads, prefetch the first nodes
+            cursor[i] = this->table[Range::bucket(hashes[i], this->size)];
+            __builtin_prefetch(cursor[i]);
+            out[base + i] = nullptr;
+            HASHMAP_STAT(probes[i] = 0);
+        }
+        unsigned long pending = w;
+        while (pending > 0){                    // stage 3: advance every unresolved chain by one node per round
+            pending = 0;
+            for (unsigned long i = 0; i < w; i++){
+                Node *node = cursor[i];
+                if (node == nullptr){
+                    continue;
+                }
+                HASHMAP_STAT(probes[i]++);
+                if (node->hash == hashes[i] && this->equals(node->key, keys[base + i])){
+                    HASHMAP_STAT(this->counters.lookup(true, probes[i]));
+                    out[base + i] = &node->value;
+                    cursor[i] = nullptr;
+                    continue;
+                }
+                cursor[i] = node->next;
+                if (cursor[i] != nullptr){
+                    __builtin_prefetch(cursor[i]);
+                    pending++;
+                }
+            }
+        }
+        if (this->oldTable != nullptr){         // misses may still be sitting in an unmigrated old bucket
+            for (unsigned long i = 0; i < w; i++){
+                if (out[base + i] == nullptr){  // (findNode counts these again as whole lookups)
+                    Node *node = this->findNode(keys[base + i], hashes[i]);
+                    out[base + i] = node != nullptr ? &node->value : nullptr;
+                }
+            }
+        }
+#ifdef HASHMAP_STATS
+        else{
+            for (unsigned long i = 0; i < w; i++){
+                if (out[base + i] == nullptr){
+                    this->counters.lookup(false, probes[i]);
+                }
+            }
+        }
+#endif
+    }
+}
+
+// Const lookup, identical to find() except that it leaves any migration where it is
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+const Value *HashMap<Key, Value, Hash, Eq, Pool, Range>::find(const K& key) const{
+    Node *node = this->findNode(key, this->hasher(key));
+    return node != nullptr ? &node->value : nullptr;
+}
+
+// Unlink and free the entry find() would return for key
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class K>
+bool HashMap<Key, Value, Hash, Eq, Pool, Range>::erase(const K& key){
+    this->migrate(REHASH_STEP);
+    unsigned long hash = this->hasher(key);
+    Node **link = nullptr;
+    for (Node **l = &this->table[Range::bucket(hash, this->size)]; *l != nullptr; l = &(*l)->next){
+        if ((*l)->hash == hash && this->equals((*l)->key, key)){
+            link = l;
+            break;
+        }
+    }
+    if (link == nullptr && this->oldTable != nullptr){  // then an unmigrated old bucket, in findNode()'s order
+        unsigned long oldValue = Range::bucket(hash, this->oldSize);
+        if (oldValue >= this->migrateIndex){
+            for (Node **l = &this->oldTable[oldValue]; *l != nullptr; l = &(*l)->next){
+                if ((*l)->hash == hash && this->equals((*l)->key, key)){
+                    link = l;
+                    break;
+                }
+            }
+        }
+    }
+    if (link == nullptr){
+        return false;
+    }
+    Node *node = *link;
+    *link = node->next;                         // unlink before destroying
+    node->~Node();
+    this->pool.deallocate(node, sizeof(Node));  // slab pools put it on their free list
+    this->count--;
+    return true;
+}
+
+// Head of bucket i of the current table
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+const typename HashMap<Key, Value, Hash, Eq, Pool, Range>::Node *HashMap<Key, Value, Hash, Eq, Pool, Range>::bucket(unsigned long i) const{
+    return this->table[i];
+}
+
+// Whether a node of bucket i ahead of node holds the same key: chains are newest first, so find() never returns node
+// (no lookup is counted, so threads may ask about their own bucket ranges at once)
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+bool HashMap<Key, Value, Hash, Eq, Pool, Range>::isShadowed(unsigned long i, const Node *node) const{
+    return this->heldBefore(this->table[i], node, node);
+}
+
+// The node allocator
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+Pool& HashMap<Key, Value, Hash, Eq, Pool, Range>::getPool(){
+    return this->pool;
+}
+
+// Visit every entry, including those still waiting in the old table
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class F>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::forEach(F visit) const{
+    for (unsigned long i = 0; i < this->size; i++){
+        for (const Node *temp = this->table[i]; temp != nullptr; temp = temp->next){
+            visit(temp->key, temp->value);
+        }
+    }
+    for (unsigned long i = this->migrateIndex; i < this->oldSize; i++){
+        for (const Node *temp = this->oldTable[i]; temp != nullptr; temp = temp->next){
+            visit(temp->key, temp->value);
+        }
+    }
+}
+
+// Visit the entry find() returns for every key, including those still waiting in the old table: a node is skipped
+// when a node ahead of it in its chain, or for an old node anywhere in the key's new bucket, holds the same key
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+template <class F>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::forEachNewest(F visit) const{
+    for (unsigned long i = 0; i < this->size; i++){
+        for (const Node *temp = this->table[i]; temp != nullptr; temp = temp->next){
+            if (!this->heldBefore(this->table[i], temp, temp)){
+                visit(temp->key, temp->value);
+            }
+        }
+    }
+    for (unsigned long i = this->migrateIndex; i < this->oldSize; i++){
+        for (const Node *temp = this->oldTable[i]; temp != nullptr; temp = temp->next){
+            if (!this->heldBefore(this->oldTable[i], temp, temp) &&
+                !this->heldBefore(this->table[Range::bucket(temp->hash, this->size)], nullptr, temp)){
+                visit(temp->key, temp->value);
+            }
+        }
+    }
+}
+
+// Snapshot of the table's shape, walking every bucket, plus the running counters
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+HashMapStats HashMap<Key, Value, Hash, Eq, Pool, Range>::stats() const{
+    HashMapStats s;
+    s.count = this->count;
+    s.buckets = this->size + this->oldSize;
+    s.loadFactor = this->getLoadFactor();
+    s.memoryBytes = this->memoryUsage();
+    s.rehashing = this->oldTable != nullptr;
+    HASHMAP_STAT(s.counters = this->counters);
+    auto chain = [&s](const Node *head, unsigned long i){
+        unsigned long length = 0;
+        for (; head != nullptr; head = head->next){
+            length++;
+        }
+        s.occupied += length > 0;
+        s.chains[length < STATS_CHAIN_BUCKETS - 1 ? length : STATS_CHAIN_BUCKETS - 1]++;
+        if (length > s.maxChain){
+            s.maxChain = length;
+            s.hottestBucket = i;
+        }
+    };
+    for (unsigned long i = 0; i < this->size; i++){
+        chain(this->table[i], i);
+    }
+    for (unsigned long i = 0; i < this->oldSize; i++){      // migrated old buckets count as empty
+        chain(this->oldTable[i], i);
+    }
+    return s;
+}
+
+// Zero the running counters
+template <class Key, class Value, class Hash, class Eq, class Pool, class Range>
+void HashMap<Key, Value, Hash, Eq, Pool, Range>::resetStats(){
+    HASHMAP_STAT(this->counters = HashMapCounters());
+}
+
+#endif //HASHMAP_H
@@ -0,0 +1,142 @@
+/****************************************************************
+ * Hash table statistics.
+ *
+ * HashMap::stats() returns a HashMapStats snapshot with two kinds
+ * of figures:
+ *   - the shape of the table right now (entries, buckets, load
+ *     factor, occupied buckets, chain length histogram, the longest
+ *     chain and where it is, bytes in use), found by walking the
+ *     bucket array when the snapshot is taken, and
+ *   - running counters (hits and misses with the nodes each one had
+ *     to look at, resize events), kept by the table as it works.
+ *
+ * The counters only exist when compiled with -DHASHMAP_STATS (make
+ * STATS=1). Without it every counter update is compiled out, lookups
+ * cost exactly what they did before, and the counters read as zero.
+ * Like the rest of HashMap they are plain integers, not atomics.
+ *
+ * Subtracting two snapshots gives what happened in between, so a
+ * process can write one out every so often and watch the probe
+ * averages and the longest chain for a batch of IDs that all land
+ * in the same few buckets.
+ ****************************************************************/
+
+#ifndef HASHSTATS_H
+#define HASHSTATS_H
+
+#include <cstdio>       // snapshot output
+
+#define STATS_CHAIN_BUCKETS 9   // chain length histogram: 0 through 7 and 8 or more
+
+#ifdef HASHMAP_STATS
+#define HASHMAP_STAT(statement) statement
+#else
+#define HASHMAP_STAT(statement)
+#endif
+
+// Running counters kept by a table while HASHMAP_STATS is defined
+struct HashMapCounters {
+    unsigned long hits = 0;                                 // lookups that found their key
+    unsigned long misses = 0;                               // lookups that didn't
+    unsigned long hitProbes = 0;                            // nodes compared by all hits
+    unsigned long missProbes = 0;                           // nodes compared by all misses
+    unsigned long maxHitProbes = 0;                         // most nodes compared by a single hit
+    unsigned long maxMissProbes = 0;                        // most nodes compared by a single miss
+    unsigned long resizes = 0;                              // times the bucket array was replaced
+
+    void lookup(bool hit, unsigned long probes){            // record one lookup
+        if(hit){
+            this->hits++;
+            this->hitProbes += probes;
+            this->maxHitProbes = probes > this->maxHitProbes ? probes : this->maxHitProbes;
+        }
+        else{
+            this->misses++;
+            this->missProbes += probes;
+            this->maxMissProbes = probes > this->maxMissProbes ? probes : this->maxMissProbes;
+        }
+    }
+};
+
+/*******************************************
+ * HashMapStats struct contents by section:
+ * 1. HashMapStats shape of the table
+ * 2. HashMapStats running counters
+ * 3. HashMapStats method prototypes
+ *******************************************/
+struct HashMapStats {
+    // 1.
+    unsigned long count = 0;                                // entries
+    unsigned long buckets = 0;                              // buckets (both tables while growing)
+    unsigned long occupied = 0;                             // buckets holding at least one entry
+    double loadFactor = 0;                                  // entries per bucket of the current table
+    unsigned long chains[STATS_CHAIN_BUCKETS] = {};         // buckets holding 0..7 and 8+ entries
+    unsigned long maxChain = 0;                             // longest chain
+    unsigned long hottestBucket = 0;                        // index of the longest chain (finish any rehash first)
+    unsigned long memoryBytes = 0;                          // bytes held by the bucket arrays and nodes
+    bool rehashing = false;                                 // an old table was still being drained
+
+    // 2.
+    HashMapCounters counters;                               // all zero unless compiled with HASHMAP_STATS
+
+    // 3.
+    double avgHitProbes() const;                            // nodes compared per hit
+    double avgMissProbes() const;                           // nodes compared per miss
+    HashMapStats operator-(const HashMapStats& earlier) const;  // counters since earlier, shape as of this snapshot
+    void print(FILE *out) const;                            // human readable summary
+    void writeJSON(FILE *out) const;                        // one JSON object on one line
+};
+
+// Nodes compared per successful lookup
+inline double HashMapStats::avgHitProbes() const{
+    return this->counters.hits > 0 ? static_cast<double>(this->counters.hitProbes) / this->counters.hits : 0;
+}
+
+// Nodes compared per failed lookup
+inline double HashMapStats::avgMissProbes() const{
+    return this->counters.misses > 0 ? static_cast<double>(this->counters.missProbes) / this->counters.misses : 0;
+}
+
+// What happened between earlier and this snapshot (the maxima can't be split, they stay as of this snapshot)
+inline HashMapStats HashMapStats::operator-(const HashMapStats& earlier) const{
+    HashMapStats diff = *this;
+    diff.counters.hits -= earlier.counters.hits;
+    diff.counters.misses -= earlier.counters.misses;
+    diff.counters.hitProbes -= earlier.counters.hitProbes;
+    diff.counters.missProbes -= earlier.counters.missProbes;
+    diff.counters.resizes -= earlier.counters.resizes;
+    return diff;
+}
+
+// Human readable summary
+inline void HashMapStats::print(FILE *out) const{
+    fprintf(out, "entries %lu | buckets %lu (%lu occupied) | load factor %.3f | %lu bytes%s\n", this->count,
+            this->buckets, this->occupied, this->loadFactor, this->memoryBytes, this->rehashing ? " | rehashing" : "");
+    fprintf(out, "chain lengths:");
+    for(int i = 0; i < STATS_CHAIN_BUCKETS; i++){
+        fprintf(out, i + 1 < STATS_CHAIN_BUCKETS ? " %d:%lu" : " %d+:%lu", i, this->chains[i]);
+    }
+    fprintf(out, " | longest %lu (bucket %lu)\n", this->maxChain, this->hottestBucket);
+#ifdef HASHMAP_STATS
+    fprintf(out, "hits %lu (%.2f probes avg, %lu max) | misses %lu (%.2f probes avg, %lu max) | resizes %lu\n",
+            this->counters.hits, this->avgHitProbes(), this->counters.maxHitProbes, this->counters.misses,
+            this->avgMissProbes(), this->counters.maxMissProbes, this->counters.resizes);
+#endif
+}
+
+// One JSON object on one line, so periodic snapshots can be appended to a log
+inline void HashMapStats::writeJSON(FILE *out) const{
+    fprintf(out, "{\"count\": %lu, \"buckets\": %lu, \"occupied\": %lu, \"load_factor\": %.4f, \"chains\": [",
+            this->count, this->buckets, this->occupied, this->loadFactor);
+    for(int i = 0; i < STATS_CHAIN_BUCKETS; i++){
+        fprintf(out, i > 0 ? ", %lu" : "%lu", this->chains[i]);
+    }
+    fprintf(out, "], \"max_chain\": %lu, \"hottest_bucket\": %lu, \"memory_bytes\": %lu, \"rehashing\": %s, "
+                 "\"hits\": %lu, \"misses\": %lu, \"avg_hit_probes\": %.3f, \"avg_miss_probes\": %.3f, "
+                 "\"max_hit_probes\": %lu, \"max_miss_probes\": %lu, \"resizes\": %lu}\n",
+            this->maxChain, this->hottestBucket, this->memoryBytes, this->rehashing ? "true" : "false",
+            this->counters.hits, this->counters.misses, this->avgHitProbes(), this->avgMissProbes(),
+            this->counters.maxHitProbes, this->counters.maxMissProbes, this->counters.resizes);
+}
+
+#endif //HASHSTATS_H
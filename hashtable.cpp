@@ -4,10 +4,10 @@
  * algorithm on a 10-digit Student ID and then taking the modulo
  * of the result. This program uses separate chaining, i.e., this
  * is a linked list implementation and does not use the C++ STL
- * member list. Instead, a Student class accompanies the HashMap
- * class and provides pointer references to memory locations in
- * order to access data members of each student and uses them as
- * "nodes" in the linked list implementation.
+ * member list. The tables themselves are generic templates that
+ * live in hashmap.h (chaining) and flathashmap.h (open
+ * addressing); this file instantiates them for Student records
+ * keyed by their ID and drives them from an interactive menu.
  *
  * Version:         1.0.0
  * Release date:    16 May, 2022
@@ -18,263 +18,272 @@
  ****************************************************************/
 
 #include <iostream>     // input/output
-#include <iomanip>      // allows for gpa precision manipulation
 #include <string>       // string manipulation
-#include <random>       // used for mt19337 rng
-
-using std::string;      // global use of std::string due to illegality of class usage of "using"
-                        // std::string is also widely used throughout the entire program
+#include <chrono>       // timing for imports, exports and mapping a snapshot
+#include <utility>      // std::as_const for the read only display
+#include "student.h"    // Student records and StudentMap
+#include "flathashmap.h"    // generic open addressing engine
+#include "compactstudent.h" // packed records with pooled names
+#include "generator.h"  // seeded synthetic students
+#include "snapshot.h"   // memory mapped tables that survive a restart
+#include "importer.h"   // parallel CSV/binary bulk loads
+#include "server.h"     // pipelined command server and its client
+#include "exporter.h"   // parallel CSV/JSON/binary dumps
+#include "bloomfilter.h"    // the --filter table with a Bloom filter in front of lookups
 
 #define TABLE_SIZE 97   // predefined table size for quick testing of a large array
 
-/**********************************************************
- * Student class contents by section:
- * 1. Student class private data members
- * 2. Student constructor prototypes
- * 3. Student class method prototypes: getters and setters
- **********************************************************/
-class Student{
-private:
-    // 1.
-    string name;                                            // student's name
-    string id;                                              // student's id
-    unsigned int age;                                       // student's age
-    double gpa;                                             // student's gpa
-    unsigned long value;                                    // student's hash value
-    Student* next;                                          // pointer to the next student with the same hash value
-    
-public:
-    // 2.
-    Student(string name, string id, int age,
-            double gpa, unsigned long value);               // Overloaded student constructor
-    Student();                                              // Null student constructor
-    
-    // 3.
-    string getName() const;                                 // get student's name
-    void setName(string n);                                 // set student's name
-    string getID() const;                                   // get student's ID
-    void setID(string i);                                   // set student's ID
-    __attribute__((unused)) unsigned int getAge() const;    // get student's age (unused in this version)
-    void setAge(unsigned int a);                            // set student's age
-    __attribute__((unused)) double getGPA() const;          // get student's GPA (unused in this version)
-    void setGPA(double g);                                  // set student's GPA
-    unsigned long getValue() const;                         // get student's hash value
-    void setValue(unsigned long val);                       // set the student's hash value
-    Student *getNext() const;                               // get the student's next pointer
-    void setNext(Student *s);                               // set the student's next pointer
-    void display() const;                                   // display student information
-};
+using FlatStudentMap = FlatHashMap<string, Student, StringHash, StringEq>;
+using FilteredStudentMap = FilteredHashMap<string, Student, StringHash, StringEq>;
 
-/***************************************
- * HashMap class contents by section:
- * 1. HashMap class private data members
- * 2. HashMap constructor prototype
- * 3. HashMap destructor prototype
- * 4. HashMap class method prototypes
- ***************************************/
-class HashMap {
-private:
-    // 1.
-    Student **table;                                        // HashMap's array of Student pointers
-    int size;                                               // HashMap's size
-    
-public:
-    // 2.
-    explicit HashMap(int size);                             // construct a HashMap object with a table of size "size"
-    
-    // 3.
-    ~HashMap();                                             // memory management/destructor
-    
-    // 4.
-    void display();                                         // class method to display the hash table's contents
-    unsigned int getSize() const;                           // get the size data member of this HashMap object
-    void autoPut(Student* s);                               // method to insert a student into the hash table
-    void manualPut();                                       // method to gather student info (calls autoPut to insert)
-    void existenceQuery();                                  // determines the existence of a Student in the table
-};
+static StudentGenerator generator;                          // every generated student and ID comes from here (seed 42 or --seed)
 
 /***************************
  * Static methods to be used
  ***************************/
-static string genID();                                      // method to generate a random 10-digit student id
-static string genName();                                    // method to generate a random first and last student name
-                                                            // with respect to a male or female name
-static int genAge();                                        // method to generate a random student age
-static double genGPA();                                     // method to generate a random student gpa
-static unsigned long hashID(const string& str);             // method to calculate a student's hash value operating on
-                                                            // the 10-digit id that's passed into it
-static Student *genStudent(const HashMap& hm);              // method that calls the other gen methods to generate a student
 static void displayMenu();
+template <class Table> static void autoPut(Table& table, Student s); // insert a student keyed by its ID
+static void autoPut(CompactStudentTable& table, const Student& s);  // pack a student into the compact table
+static void autoPut(StudentSnapshot& table, const Student& s);  // write a student to the snapshot's overlay
+template <class Table>
+static void showStudent(const Table& table, const string& id,
+                        const Student& s);                  // display a student found in either full engine
+static void showStudent(const CompactStudentTable& table, const string& id,
+                        const CompactStudent& s);           // display a compact record through its table's pool
+static void showStudent(const StudentSnapshot& table, const string& id,
+                        const SnapshotRecord& s);           // display a mapped or overlay record
+template <class Pool>
+static void display(HashMap<string, Student, StringHash, StringEq, Pool>& table);  // display the chained table by bucket
+template <class Pool>
+static void display(const HashMap<string, Student, StringHash, StringEq, Pool>& table);   // the same once rehashed
+static void display(const FlatStudentMap& table);           // display the flat table slot by slot
+static void display(const CompactStudentTable& table);      // display the compact table
+static void display(const StudentSnapshot& table);          // display the snapshot and its overlay
+static void display(FilteredStudentMap& table);             // display the table behind the filter
+template <class Table> static void manualPut(Table& table); // gather student info (calls autoPut to insert)
+template <class Table> static void existenceQuery(Table& table); // determines the existence of a Student in the table
+template <class Table> static void runMenu(Table& table);   // drive either engine from the interactive menu
+template <class Table>
+static void importFile(Table& table, const string& path);   // bulk load a CSV or binary file into any mode
+template <class Pool>
+static void importFile(HashMap<string, Student, StringHash, StringEq, Pool>& table, const string& path,
+                       FILE *out = stdout);                 // bulk load a file into the chained table in parallel
+static void importFile(FilteredStudentMap& table, const string& path);  // bulk load, then rebuild the filter once
+static void printImport(const string& path, const ImportResult& r, double ms,
+                        FILE *out = stdout);                // summary line of an import
+static void runServer(const string& socketPath, const string& importPath);  // serve stdin/stdout or a Unix socket
+static void runExport(const string& exportPath, const string& importPath);  // import, then export to a file or stdout
 
 /*******************
  * MAIN METHOD BEGIN
  *******************/
-int main() {
-    // cin can be used in the main method's scope
-    using std::cin;
-    
-    // initialize a hashmap with the predefined TABLE_SIZE of 97
-    HashMap hashMap = HashMap(TABLE_SIZE);
-
+int main(int argc, char *argv[]) {
     /*
-     * generate a number of students equal to the size of the hash table
-     * (collisions are expected and resolved in autoPut())
+     * command line options:
+     *   --flat         use the open addressing FlatHashMap instead of HashMap
+     *   --compact      use packed records with integer IDs and pooled names
+     *   --seed S       generate a different population (default 42)
+     *   --snapshot FILE  serve the menu from a memory mapped snapshot, saving changes back to FILE on exit
+     *   --import FILE  load the students in a CSV or binary FILE before showing the menu
+     *   --serve        answer GET/PUT/EXISTS/DEL/STATS request lines from stdin on stdout instead of the menu
+     *   --serve-socket PATH  answer the same requests from any number of clients on a Unix socket until SHUTDOWN
+     *   --export FILE  write the imported students to FILE (.csv, .json or binary, - for CSV on stdout) and exit
+     *   --filter P     put a Bloom filter with false positive rate P (e.g. 0.01) in front of the table's lookups
      */
-    for(int i = 0; i < hashMap.getSize(); i++){
-        // generate and insert the student into the hashmap
-        hashMap.autoPut(genStudent(hashMap));
+    bool flat = false;
+    bool compact = false;
+    string snapshotPath;
+    string importPath;
+    bool serve = false;
+    string socketPath;
+    string exportPath;
+    double filterRate = 0;                                  // 0: no filter
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--flat"){
+            flat = true;
+        }
+        else if(arg == "--compact"){
+            compact = true;
+        }
+        else if(arg == "--snapshot" && i + 1 < argc){
+            snapshotPath = argv[++i];
+        }
+        else if(arg == "--import" && i + 1 < argc){
+            importPath = argv[++i];
+        }
+        else if(arg == "--serve"){
+            serve = true;
+        }
+        else if(arg == "--serve-socket" && i + 1 < argc){
+            serve = true;
+            socketPath = argv[++i];
+        }
+        else if(arg == "--export" && i + 1 < argc){
+            exportPath = argv[++i];
+        }
+        else if(arg == "--filter" && i + 1 < argc){
+            filterRate = std::stod(argv[++i]);
+        }
+        else if(arg == "--seed" && i + 1 < argc){
+            generator.reseed(std::stoull(argv[++i]));
+        }
+        else{
+            printf("usage: %s [--flat | --compact | --snapshot FILE | --filter P] [--seed S] [--import FILE]\n"
+                   "       [--serve | --serve-socket PATH] [--export FILE]\n"
+                   "(the timing reports are in benchmark)\n",
+                   argv[0]);
+            return 1;
+        }
     }
-
-    hashMap.display();
     
-    unsigned int input = 0;
-    do{
-        displayMenu();
-        
-        cin >> input;
-        
-        /***********************
-         * SWITCH MENU BEGINNING
-         ***********************/
-        switch (input){
-            case 1:
-                hashMap.existenceQuery();
-                break;
-            case 2:
-                hashMap.manualPut();
-                break;
-            case 3:
-                hashMap.autoPut(genStudent(hashMap));
-                break;
-            case 4:
-                hashMap.display();
-                break;
-            case 5:
-                printf("Terminating program. Thank you!\n");
-                break;
-            default:
-                printf("This is an invalid entry. Rerouting to the query. . .\n");
-                break;
+    if(serve){
+        runServer(socketPath, importPath);
+    }
+    else if(!exportPath.empty()){
+        runExport(exportPath, importPath);
+    }
+    else if(!snapshotPath.empty()){
+        StudentSnapshot snapshot;
+        auto start = std::chrono::steady_clock::now();
+        if(snapshot.open(snapshotPath)){
+            printf("Mapped %lu students from %s in %.3f ms\n", snapshot.getCount(), snapshotPath.c_str(),
+                   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
         }
-    }while(input != 5);
+        else{
+            printf("No snapshot at %s yet, starting a new one\n", snapshotPath.c_str());
+        }
+        importFile(snapshot, importPath);
+        runMenu(snapshot);
+        if(snapshot.getOverlayCount() > 0){                 // only rewrite the file if something changed
+            if(snapshot.snapshot(snapshotPath)){
+                printf("Saved %lu students to %s\n", snapshot.getCount(), snapshotPath.c_str());
+            }
+            else{
+                printf("\033[1;31mCouldn't save the snapshot to %s\n\033[0m", snapshotPath.c_str());
+            }
+        }
+    }
+    else if(compact){
+        CompactStudentTable compactTable(TABLE_SIZE);
+        importFile(compactTable, importPath);
+        runMenu(compactTable);
+    }
+    else if(flat){
+        FlatStudentMap flatMap(TABLE_SIZE);
+        importFile(flatMap, importPath);
+        runMenu(flatMap);
+    }
+    else if(filterRate > 0){
+        FilteredStudentMap filtered(TABLE_SIZE, filterRate);
+        importFile(filtered, importPath);
+        runMenu(filtered);
+    }
+    else{
+        // initialize a hashmap with the predefined TABLE_SIZE of 97
+        StudentMap hashMap(TABLE_SIZE);
+        importFile(hashMap, importPath);
+        runMenu(hashMap);
+    }
+    return 0;
 }
 /*****************
  * MAIN METHOD END
  *****************/
 
-// Null Student constructor
-Student::Student(){
-    this->name = "null";            // set this student's name to null
-    this->id = "null";              // set this student's id to null
-    this->age = 0;                  // set this student's age to 0
-    this->gpa = 0.0;                // set this student's gpa to 0.0
-    this->value = 0;                // set this student's hash value to 0 (will be updated later)
-    this->next = nullptr;           // set this student's next pointer to nullptr
+// Insert a student into either engine, keyed by its ID
+template <class Table>
+static void autoPut(Table& table, Student s){
+    string id = s.getID();
+    table.put(std::move(id), std::move(s));
 }
 
-// Overloaded Student constructor
-Student::Student(string name, string id, int age, double gpa, unsigned long value){
-    this->name = move(name);        // set this student's name to name
-    this->id = move(id);            // set this student's id to id
-    this->age = age;                // set this student's age to age
-    this->gpa = gpa;                // set this student's gpa to gpa
-    this->value = value;            // set this student's hash value to value
-    this->next = nullptr;           // initially, this student doesn't point to another student so set to nullptr
-}
-
-// Student name getter
-string Student::getName() const{
-    return this->name;
-}
-
-void Student::setName(string n){
-    this->name = std::move(n);
-}
-
-// Student ID getter
-string Student::getID() const{
-    return this->id;
-}
-
-//
-void Student::setID(string i){
-    this->id = std::move(i);
-}
-
-// Student age getter (unused in this version)
-__attribute__((unused)) unsigned int Student::getAge() const{
-    return this->age;
+// Pack a student into the compact table (IDs that aren't 10 digits can't be stored as integers)
+static void autoPut(CompactStudentTable& table, const Student& s){
+    if(!table.put(s.getName(), s.getID(), s.getAge(), s.getGPA())){
+        printf("\033[1;31mCompact mode needs a numeric ID, %s was not added.\n\033[0m", s.getID().c_str());
+    }
 }
 
-void Student::setAge(unsigned int a){
-    this->age = a;
+// Write a student to the snapshot's in-memory overlay
+static void autoPut(StudentSnapshot& table, const Student& s){
+    if(!table.put(s)){
+        printf("\033[1;31mSnapshots store IDs of up to %d characters, %s was not added.\n\033[0m",
+               SNAPSHOT_ID_BYTES, s.getID().c_str());
+    }
 }
 
-// Student GPA getter (unused in this version)
-__attribute__((unused)) double Student::getGPA() const{
-    return this->gpa;
+// Display a student found in either full engine
+template <class Table>
+static void showStudent(const Table&, const string&, const Student& s){
+    s.display();
 }
 
-void Student::setGPA(double g){
-    this->gpa = g;
+// Display a compact record, unpacking it through its table's name pool
+static void showStudent(const CompactStudentTable& table, const string& id, const CompactStudent& s){
+    Student(string(table.getName(s)), id, s.age, s.gpa / 100.0).display();
 }
 
-// Student hash value getter
-unsigned long Student::getValue() const{
-    return this->value;
+// Display a snapshot record, whether it is mapped from the file or in the overlay
+static void showStudent(const StudentSnapshot&, const string& id, const SnapshotRecord& s){
+    Student(string(s.getName()), id, s.getAge(), s.getGPA()).display();
 }
 
-// Student hash value setter
-void Student::setValue(unsigned long val){
-    this->value = val;
+// Method to display the chained table bucket by bucket
+template <class Pool>
+static void display(HashMap<string, Student, StringHash, StringEq, Pool>& table){
+    table.finishRehash();                       // make sure every student is in the current table
+    display(std::as_const(table));
 }
 
-// Student next pointer getter
-Student *Student::getNext() const{
-    return this->next;
+// Method to display a chained table that has finished rehashing
+template <class Pool>
+static void display(const HashMap<string, Student, StringHash, StringEq, Pool>& table){
+    using std::cout;
+    for(unsigned long i = 0; i < table.getSize(); i++){
+        cout << "Hash Value: " << i << "\n";    // print this index's hash value
+        
+        for(auto temp = table.bucket(i); temp != nullptr; temp = temp->next){
+            temp->value.display();              // display the actual student
+        }
+        
+        if(i + 1 != table.getSize()) {
+            cout << "\n";                       // add a line at the end of the hash table output for aesthetics
+        }
+    }
 }
 
-// Student next pointer setter
-void Student::setNext(Student *s){
-    this->next = s;
+// Method to display every student of the compact table
+static void display(const CompactStudentTable& table){
+    table.forEach([&table](uint64_t id, const CompactStudent& s){
+        Student(string(table.getName(s)), formatID(id), s.age, s.gpa / 100.0).display();
+    });
 }
 
-void Student::display() const{
-    using std::cout;
-    using std::setprecision;
-    using std::fixed;
-    cout << "Name: ";
-    cout.width(20);
-    cout << this->name << " | ID: " << this->id << " | Age: " << this->age
-         << " | GPA: " << setprecision(2) << fixed << this->gpa << "\n";
+// Method to display every student of the snapshot, overlay first
+static void display(const StudentSnapshot& table){
+    table.forEach([](std::string_view id, const SnapshotRecord& s){
+        Student(string(s.getName()), string(id), s.getAge(), s.getGPA()).display();
+    });
 }
 
-// Overloaded HashMap constructor
-HashMap::HashMap(int size){
-    this->size = size;                          // set this hashmap's size to size
-    this->table = new Student *[this->size];    // allocate memory for this hashmap's array of students
-    for (int i = 0; i < this->size; i++){       // go from 0 to size - 1 in the hash table
-        this->table[i] = new Student();         // set this hashmap's table's specific index to a Null Student
-        this->table[i]->setValue(i);            // update the student's hash value that's stored in that index
-    }
+// Method to display the chained table behind a filter
+static void display(FilteredStudentMap& table){
+    table.finishRehash();
+    display(table.getTable());
 }
 
-// HashMap destructor
-HashMap::~HashMap(){
-    for (int i = 0; i < this->size; i++) {
-        if (this->table[i] != nullptr){         // check to make sure we're not attempting to delete a nullptr (avoids seg fault)
-            Student *temp1 = this->table[i];    // create a temporary pointer to the first student in the table's index
-            while(temp1 != nullptr){            // continue until temp1 is a nullptr
-                Student *temp2 = temp1;         // create a second temporary pointer to delete while the other traverses the list
-                temp1 = temp1->getNext();       // traverse the linked list of students
-                delete temp2;                   // deallocate the student memory
-            }
-        }
-    }
-    delete[] this->table;                       // deallocate the table memory
+// Method to display every occupied slot of the flat table
+static void display(const FlatStudentMap& table){
+    table.forEachSlot([](unsigned long i, const string&, const Student& s){
+        std::cout << "Slot: " << i << " | ";
+        s.display();
+    });
 }
 
-void HashMap::manualPut(){
+// Method to gather a student's info from the user and insert it into either engine
+template <class Table>
+static void manualPut(Table& table){
     using std::cin;
     
     // variable creation for data members of student object to be inserted
@@ -282,13 +291,13 @@ void HashMap::manualPut(){
     string studentName;
     unsigned int studentAge;
     double studentGPA;
-    auto *newStudent = new Student();
+    Student newStudent;
     
     printf("We will be entering several student data. Please pay close attention to the prompts.\n"
            "Enter a student name: ");
     cin.ignore(256, '\n');                                  // ignores the next 256 new line characters
     getline(cin, studentName);                              // get line of string input for student's name
-    newStudent->setName(studentName);                       // set new student's name
+    newStudent.setName(studentName);                        // set new student's name
     
     printf("\nEnter a 10-digit student ID: ");
     getline(cin, studentID);                                // get line of string input for student's ID
@@ -298,8 +307,7 @@ void HashMap::manualPut(){
                 "Enter a 10-digit student ID: ");
         getline(cin, studentID);                            // get line of string input again for student's ID
     }
-    newStudent->setID(studentID);                           // set new student's name
-    newStudent->setValue(hashID(studentID) % this->getSize());  // set new student's hash value
+    newStudent.setID(studentID);                            // set new student's name
     
     printf("\nEnter the an age over 18: ");
     cin >> studentAge;                                      // get integer input for student's age
@@ -307,7 +315,7 @@ void HashMap::manualPut(){
         printf("That age is too low. Please enter an age over 18: ");
         cin >> studentAge;                                  // get integer input again for student's age
     }
-    newStudent->setAge(studentAge);                         // set new student's age
+    newStudent.setAge(studentAge);                          // set new student's age
     
     printf("\nEnter a GPA as high as a 4.0: ");
     cin >> studentGPA;                                      // get double floating point input for student's GPA
@@ -316,26 +324,18 @@ void HashMap::manualPut(){
                 "Enter a GPA as high as a 4.0: ");
         cin >> studentGPA;                                  // get double floating point input again for student's GPA
     }
-    newStudent->setGPA(studentGPA);                         // set new student's GPA
+    newStudent.setGPA(studentGPA);                          // set new student's GPA
     
     printf("The following student has been added to the hash table: \n"
            "\033[1;34m");
-    newStudent->display();                                  // display the new student that was entered
+    newStudent.display();                                   // display the new student that was entered
     printf("\033[0m");
-    this->autoPut(newStudent);                              // put the new student into the hash table
-}
-
-// Method to insert a Student object into the HashMap object
-void HashMap::autoPut(Student *s){
-    Student *temp = this->table[s->getValue()];             // create a temporary pointer that points to the student at the prescribed hash value
-    while (temp->getNext() != nullptr){                     // continue until the next pointer is nullptr
-        temp = temp->getNext();                             // traverse the linked list
-    }
-    temp->setNext(s);                                       // set the student s as the last student in the linked list
+    autoPut(table, newStudent);                             // put the new student into the hash table
 }
 
 // method to determine the existence of a student in the hash table
-void HashMap::existenceQuery(){
+template <class Table>
+static void existenceQuery(Table& table){
     using std::cout;
     using std::cin;
     string queryID;
@@ -348,156 +348,156 @@ void HashMap::existenceQuery(){
                 "Enter the 10-digit numeric student ID you'd like to search for: ";
         cin >> queryID;                                     // get input again for student ID query
     }
-    unsigned int value = hashID(queryID) % this->size;      // calculate the hash value
-    Student *temp = this->table[value];                     // begin search at the first student object at that value
-    while(temp != nullptr){                                 // continue searching until the end of linked list
+    
+    const auto *temp = table.find(queryID);
+    if(temp != nullptr){
         // student found!!! :D
-        if(temp->getID() == queryID){
-            cout << "\033[1;34m";
-            temp->display();                                // display found student
-            cout << "\033[0m";
-            break;                                          // leave the while loop to avoid unnecessary work
-        }
-        
-        temp = temp->getNext();                             // jump to next student in linked list
-        
+        cout << "\033[1;34m";
+        showStudent(table, queryID, *temp);                 // display found student
+        cout << "\033[0m";
+    }
+    else{
         // student not found :(
-        if(temp == nullptr){
-            cout << "\033[1;31mThis student doesn't exist in this hash table.\n\033[0m";
-        }
+        cout << "\033[1;31mThis student doesn't exist in this hash table.\n\033[0m";
     }
 }
 
-// Method to display the hash table of the HashMap object
-void HashMap::display(){
-    using std::cout;
-    for(int i = 0; i < this->size; i++){
-        Student *temp = this->table[i];             // create a temporary pointer equal to the first student pointer in the linked list
-        
-        cout << "Hash Value: " << this->table[i]->getValue() << "\n";   // print this index's hash value
+static void displayMenu(){
+    printf("\nMain menu:\n"
+           "\033[1;32m1. Search and Display Student\n"
+           "2. Manually Insert Student Into Hash Table\n"
+           "3. Generate Student and Insert Into Hash Table\n"
+           "4. Display Entire Hash Table\n"
+           "5. Exit Program\n\033[0m"
+           "Please make a selection between 1 and 5: ");
+}
+
+// Fill either engine with generated students and run the interactive menu on it
+template <class Table>
+static void runMenu(Table& table){
+    // cin can be used in this method's scope
+    using std::cin;
+    
+    /*
+     * generate a number of students equal to the initial size of the hash table
+     * (collisions are expected and resolved in autoPut()), unless it came with students already
+     */
+    int generated = table.getCount() == 0 ? TABLE_SIZE : 0;
+    for(int i = 0; i < generated; i++){
+        // generate and insert the student into the table
+        autoPut(table, generator.nextStudent());
+    }
+
+    display(table);
+    
+    unsigned int input = 0;
+    do{
+        displayMenu();
         
-        while(temp != nullptr){                     // continue until the temporary pointer is nullptr
-            if(temp->getName() == "null"){          // check if this is the place holding pointer at the beginning of the linked list
-                temp = temp->getNext();             // move the pointer forward in the linked list
-                continue;                           // jump to the loop condition to avoid unnecessary work
-            }
-            else{
-                temp->display();                    // display the actual student
-                temp = temp->getNext();
-            }
-        }
+        cin >> input;
         
-        if(i + 1 != this->size) {
-            cout << "\n";                           // add a line at the end of the hash table output for aesthetics
+        /***********************
+         * SWITCH MENU BEGINNING
+         ***********************/
+        switch (input){
+            case 1:
+                existenceQuery(table);
+                break;
+            case 2:
+                manualPut(table);
+                break;
+            case 3:
+                autoPut(table, generator.nextStudent());
+                break;
+            case 4:
+                display(table);
+                break;
+            case 5:
+                printf("Terminating program. Thank you!\n");
+                break;
+            default:
+                printf("This is an invalid entry. Rerouting to the query. . .\n");
+                break;
         }
-    }
-}
-
-// HashMap hash table size getter
-unsigned int HashMap::getSize() const{
-    return this->size;
+    }while(input != 5);
 }
 
-// Method for randomly generating a 10-digit ID
-static string genID(){
-    using std::random_device;
-    using std::mt19937;
-    using std::uniform_int_distribution;
-    using std::to_string;
-    
-    string randNums = "9";                          // set all student IDs to start with the number 9
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_int_distribution<int> dist9(0, 9);      // set to generate any integer between 0 and 9, inclusive
-    for(int i = 0; i < 9; i++){                     // run the generator 9 times for a total of 10 digits
-        int randInt = dist9(rng);                   // generate random single-digit integer
-        randNums += to_string(randInt);             // append to the randNums string
+// Print what an import did (nothing was asked for if path is empty)
+static void printImport(const string& path, const ImportResult& r, double ms, FILE *out){
+    if(!r.opened){
+        fprintf(out, "\033[1;31mCouldn't read %s\n\033[0m", path.c_str());
+        return;
+    }
+    fprintf(out, "Imported %lu students from %s in %.1f ms (%.1f MB/s)", r.imported, path.c_str(), ms,
+            r.bytes / ms / 1e3);
+    if(r.rejected > 0){
+        fprintf(out, ", rejected %lu (the first at byte %lu)", r.rejected, r.firstRejected);
     }
-    return randNums;                                // return the resulting student ID
+    fprintf(out, "\n");
 }
 
-// Method for randomly generating a first and last name
-static string genName(){
-    using std::random_device;
-    using std::mt19937;
-    using std::uniform_int_distribution;
-    
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_int_distribution<int> dist41(0, 41);    // set to generate any integer between [0 and 41]
-    
-    string first[] = {"Brigitte", "Stephanie", "Jennifer", "Yolanda", "Ju", "Fen", "Min",
-                      "Nora", "Aria", "Nova", "Jade", "Leilani", "Samantha", "Sage",
-                      "Rachel", "Sutton", "Harlow", "Gia", "Amina", "Ariel", "Samara",
-                      "Alekzandr", "Rusty", "James", "Fei-hung", "Juan", "Gil",
-                      "Charles", "Devin", "Lucas", "Mason", "Logan", "Jackson",
-                      "Samuel", "Mateo", "Owen", "Bastian", "Maverick", "Everett",
-                      "Kai", "Titan", "Rex"};
-    string last[] = {"Dillard", "Smith", "Chi", "Li", "Castro", "Brown", "Huang", "Lee",
-                     "Moore", "Lopez", "Gomez", "Wright", "Clark", "Sanchez", "Patel",
-                     "Bryant", "Tran", "Nguyen", "Ali", "Mohammed", "Wang", "Cross",
-                     "Moss", "Quinn", "Rivas", "Chan", "Manning", "Khan", "Parsons",
-                     "Strickland", "Suarez", "Salas", "Cobb", "Moody", "Archer", "Tang",
-                     "Odom", "Hendrix", "Good", "Novak", "Lu", "Branch"};
-    
-    return first[dist41(rng)] + " " + last[dist41(rng)];    // return the resulting student name
+// Bulk load a file into any mode: parse on every core, insert one student at a time
+template <class Table>
+static void importFile(Table& table, const string& path){
+    if(path.empty()){
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ImportResult r = importEach(path, [&table](Student&& s){ autoPut(table, std::move(s)); });
+    printImport(path, r, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 }
 
-// Method for generating a name between 18 and 38
-static int genAge(){
-    using std::random_device;
-    using std::mt19937;
-    using std::uniform_int_distribution;
-    
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_int_distribution<int> dist20(0, 20);            // set to generate any integer between [0 and 20]
-    return 18 + dist20(rng);
+// Bulk load a file into the chained table, building disjoint bucket ranges on every core
+template <class Pool>
+static void importFile(HashMap<string, Student, StringHash, StringEq, Pool>& table, const string& path, FILE *out){
+    if(path.empty()){
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ImportResult r = importInto(path, table);
+    printImport(path, r, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+                out);
 }
 
-// Method for generating a GPA between 2.5 and 4.0
-static double genGPA(){
-    using std::random_device;
-    using std::mt19937;
-    using std::uniform_real_distribution;
-    
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_real_distribution<double> dist1point5(0, 1.5);  // set to generate any real number between [0 and 1.5]
-    return 2.5 + dist1point5(rng);                          // return the resulting student GPA
+// Bulk load a file into the table behind the filter, then size and fill the filter once
+static void importFile(FilteredStudentMap& table, const string& path){
+    table.bulkLoad([&path](StudentMap& t){ importFile(t, path); });
 }
 
-// DJBX33A algorithm for hashing
-static unsigned long hashID(const string& str){
-    unsigned long hash = 5381;                              // DJBX33A traditional starting point
-    for(char i : str){                                      // run loop until reaching the last character of the ID
-        unsigned long c = static_cast<unsigned char>(i);    // assign the ASCII value of the character stored in i to c
-        hash = hash * 33 + c;                               // DJBX33A hashing algorithm
+// Serve the chained table over stdin/stdout, or over a Unix socket if socketPath is set (messages go to stderr)
+static void runServer(const string& socketPath, const string& importPath){
+    StudentMap table(TABLE_SIZE);
+    importFile(table, importPath, stderr);                  // stdout may be the protocol stream
+    StudentServer server(table);
+    if(socketPath.empty()){
+        server.serveStream(STDIN_FILENO, STDOUT_FILENO);
+    }
+    else{
+        fprintf(stderr, "Listening on %s\n", socketPath.c_str());
+        if(!server.serveSocket(socketPath)){
+            fprintf(stderr, "Couldn't listen on %s\n", socketPath.c_str());
+            return;
+        }
     }
-    return hash;                                            // assign this hash value where called
+    fprintf(stderr, "Served %lu requests, %lu students in the table\n", server.getRequests(), table.getCount());
 }
 
-// Method for generating a student using the other gen methods
-static Student *genStudent(const HashMap& hm){
-    // generate a random student ID
-    string id = genID();
-    
-    // calculate the hash value of the student's ID
-    unsigned long hashValue = hashID(id);
-    
-    // create a new student
-    auto newStudent = new Student(genName(), id, genAge(), genGPA(), (hashValue % hm.getSize()));
-    
-    // return the resulting student
-    return newStudent;
+// Import importPath (if any) into the chained table and export it to exportPath (messages go to stderr)
+static void runExport(const string& exportPath, const string& importPath){
+    StudentMap table(TABLE_SIZE);
+    importFile(table, importPath, stderr);                  // stdout may be the export stream
+    auto start = std::chrono::steady_clock::now();
+    ExportResult r = exportFile(table, exportPath);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if(!r.written){
+        fprintf(stderr, "\033[1;31mCouldn't write %s\n\033[0m", exportPath.c_str());
+        return;
+    }
+    fprintf(stderr, "Exported %lu students to %s in %.1f ms (%.1f MB/s)", r.rows, exportPath.c_str(), ms,
+            r.bytes / ms / 1e3);
+    if(r.skipped > 0){
+        fprintf(stderr, ", skipped %lu with names too long for a binary record", r.skipped);
+    }
+    fprintf(stderr, "\n");
 }
 
-static void displayMenu(){
-    printf("\nMain menu:\n"
-           "\033[1;32m1. Search and Display Student\n"
-           "2. Manually Insert Student Into Hash Table\n"
-           "3. Generate Student and Insert Into Hash Table\n"
-           "4. Display Entire Hash Table\n"
-           "5. Exit Program\n\033[0m"
-           "Please make a selection between 1 and 5: ");
-}
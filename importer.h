@@ -0,0 +1,355 @@
+/****************************************************************
+ * Bulk student import from CSV and binary files.
+ *
+ * CSV files hold one student per line as name,id,age,gpa. The line
+ * is split from the right, so a name may itself contain commas, and
+ * a first line that doesn't parse (a column header) is skipped.
+ * Binary files start with BINARY_MAGIC followed by fixed size
+ * BinaryStudent records; a partial record left at the end counts as
+ * one rejected record.
+ *
+ * The file is mapped and cut into one contiguous slice per thread
+ * (CSV slices are moved forward to the next line start). Every
+ * thread parses and validates its slice with the same rules
+ * manualPut() enforces (a 10 character ID, age 18 or over, GPA no
+ * higher than 4.0) and builds its students straight into per-
+ * partition buffers, where a partition is a range of the table's
+ * buckets. The table is sized for the whole file first, so the
+ * partitions can't move, and then every partition is linked into
+ * the table by one thread with no locks (HashMap::insertPartitioned).
+ *
+ * importEach() parses the same way but hands every student to a
+ * callback on the calling thread, in file order, for tables that
+ * can't be built in parallel.
+ ****************************************************************/
+
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <cstdint>
+#include <cstring>      // memchr/memcpy
+#include <charconv>     // std::from_chars for age and GPA
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>       // parsing threads
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/mman.h>   // the file is parsed straight out of the page cache
+#include <sys/stat.h>   // fstat
+#include "student.h"    // Student records and HashMap
+
+#define BINARY_MAGIC "STUBIN1"      // 7 characters and a terminating zero
+#define BINARY_NAME_BYTES 34        // longest name a binary record can hold
+#define IMPORT_SAMPLE_BYTES 65536   // head of a CSV file estimateCount() counts lines in
+
+// One student in a binary import file, 48 bytes
+struct BinaryStudent {
+    char id[10];
+    uint8_t age;
+    uint8_t nameLength;
+    uint16_t gpa;                                           // GPA in hundredths
+    char name[BINARY_NAME_BYTES];                           // nameLength bytes, the rest zero
+};
+
+// Outcome of an import
+struct ImportResult {
+    bool opened = false;                                    // false if the file couldn't be read at all
+    unsigned long imported = 0;                             // students added to the table
+    unsigned long rejected = 0;                             // records that failed parsing or validation
+    unsigned long firstRejected = 0;                        // byte offset of the first rejected record
+    unsigned long bytes = 0;                                // size of the file
+};
+
+// The checks manualPut() makes: a 10 character ID, age 18 or over and a GPA no higher than 4.0,
+// plus a GPA that isn't negative or NaN (from_chars parses "nan" and "-1" happily)
+inline bool validStudent(std::string_view id, long age, double gpa){
+    return id.length() == 10 && age >= 18 && gpa >= 0 && gpa <= 4.0;   // NaN fails both comparisons
+}
+
+// Parse one name,id,age,gpa line (split from the right, so the name may hold commas) and validate it
+inline bool parseStudentCSV(std::string_view line, Student& out){
+    std::size_t c3 = line.rfind(',');
+    std::size_t c2 = c3 == std::string_view::npos || c3 == 0 ? std::string_view::npos : line.rfind(',', c3 - 1);
+    std::size_t c1 = c2 == std::string_view::npos || c2 == 0 ? std::string_view::npos : line.rfind(',', c2 - 1);
+    if(c1 == std::string_view::npos){
+        return false;
+    }
+    long age = 0;
+    double gpa = 0;
+    const char *end = line.data() + line.length();
+    std::from_chars_result a = std::from_chars(line.data() + c2 + 1, line.data() + c3, age);
+    std::from_chars_result g = std::from_chars(line.data() + c3 + 1, end, gpa);
+    if(a.ec != std::errc() || a.ptr != line.data() + c3 || g.ec != std::errc() || g.ptr != end ||
+       !validStudent(line.substr(c1 + 1, c2 - c1 - 1), age, gpa)){
+        return false;
+    }
+    out = Student(string(line.substr(0, c1)), string(line.substr(c1 + 1, c2 - c1 - 1)), static_cast<int>(age), gpa);
+    return true;
+}
+
+// Pack a student into a binary record, false if its name is too long
+inline bool packStudent(const Student& s, BinaryStudent& r){
+    if(s.getName().length() > BINARY_NAME_BYTES || s.getID().length() != 10){
+        return false;
+    }
+    memset(&r, 0, sizeof(r));
+    memcpy(r.id, s.getID().data(), 10);
+    r.age = static_cast<uint8_t>(s.getAge() > 255 ? 255 : s.getAge());
+    r.nameLength = static_cast<uint8_t>(s.getName().length());
+    double gpa = s.getGPA() > 0 ? s.getGPA() : 0;           // clamp to what 16 bits of hundredths hold, NaN to 0
+    r.gpa = static_cast<uint16_t>(gpa < 655.35 ? gpa * 100 + 0.5 : 65535);
+    memcpy(r.name, s.getName().data(), s.getName().length());
+    return true;
+}
+
+/*************************************************
+ * StudentFile class contents by section:
+ * 1. StudentFile class private data members
+ * 2. StudentFile constructor/destructor prototypes
+ * 3. StudentFile class method prototypes
+ *
+ * A read-only mapping of an import file and the
+ * parallel parser over it.
+ *************************************************/
+class StudentFile {
+private:
+    // 1.
+    const char *data;                                       // the mapped file (nullptr if it couldn't be opened)
+    unsigned long bytes;
+    bool binary;                                            // starts with BINARY_MAGIC
+
+    template <class F>
+    void parseCSV(unsigned long begin, unsigned long end, F emit, ImportResult& r) const;
+    template <class F>
+    void parseBinary(unsigned long begin, unsigned long end, F emit, ImportResult& r) const;
+
+public:
+    // 2.
+    explicit StudentFile(const std::string& path);
+    ~StudentFile();
+    StudentFile(const StudentFile&) = delete;
+    StudentFile& operator=(const StudentFile&) = delete;
+
+    // 3.
+    bool isOpen() const;
+    unsigned long getBytes() const;
+    unsigned long estimateCount() const;                    // records in the file (exact for binary and small files)
+    template <class F>
+    ImportResult parse(unsigned int threads, F emit) const; // emit(thread, Student&&) for every valid record
+};
+
+// Map the file and detect its format
+inline StudentFile::StudentFile(const std::string& path){
+    this->data = nullptr;
+    this->bytes = 0;
+    this->binary = false;
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0){
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED){
+            madvise(map, st.st_size, MADV_SEQUENTIAL);      // every slice is read front to back once
+            this->data = static_cast<const char *>(map);
+            this->bytes = st.st_size;
+            this->binary = this->bytes >= 8 && memcmp(this->data, BINARY_MAGIC, 8) == 0;
+        }
+    }
+    close(fd);
+}
+
+// Unmap the file
+inline StudentFile::~StudentFile(){
+    if(this->data != nullptr){
+        munmap(const_cast<char *>(this->data), this->bytes);
+    }
+}
+
+// true if the file was mapped
+inline bool StudentFile::isOpen() const{
+    return this->data != nullptr;
+}
+
+// Size of the file in bytes
+inline unsigned long StudentFile::getBytes() const{
+    return this->bytes;
+}
+
+/*
+ * Number of records, from the record size of a binary file or the line
+ * breaks of a CSV file. Only the first IMPORT_SAMPLE_BYTES are counted
+ * and the rest is scaled from them, so sizing a table doesn't read the
+ * whole file once more before the parse does; the estimate only needs
+ * to be close, since a table that ends up short grows after the load.
+ */
+inline unsigned long StudentFile::estimateCount() const{
+    if(this->binary){
+        return (this->bytes - 8) / sizeof(BinaryStudent);
+    }
+    unsigned long sample = this->bytes < IMPORT_SAMPLE_BYTES ? this->bytes : IMPORT_SAMPLE_BYTES;
+    unsigned long lines = 0;
+    for(const char *p = this->data, *end = this->data + sample;
+        (p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr; p++){
+        lines++;
+    }
+    if(sample < this->bytes){
+        return static_cast<unsigned long>(static_cast<unsigned __int128>(lines) * this->bytes / sample) + 1;
+    }
+    return lines + 1;                                       // the last line may not end in a line break
+}
+
+// Parse the CSV lines that start in [begin, end)
+template <class F>
+void StudentFile::parseCSV(unsigned long begin, unsigned long end, F emit, ImportResult& r) const{
+    const char *p = this->data + begin;
+    const char *stop = this->data + end;
+    const char *fileEnd = this->data + this->bytes;
+    if(begin > 0 && p[-1] != '\n'){                         // the line in progress belongs to the previous slice
+        const char *nl = static_cast<const char *>(memchr(p, '\n', fileEnd - p));
+        p = nl != nullptr ? nl + 1 : fileEnd;
+    }
+    while(p < stop){
+        const char *nl = static_cast<const char *>(memchr(p, '\n', fileEnd - p));
+        const char *lineEnd = nl != nullptr ? nl : fileEnd;
+        std::string_view line(p, lineEnd - p);
+        unsigned long at = p - this->data;
+        p = lineEnd + 1;
+        if(!line.empty() && line.back() == '\r'){
+            line.remove_suffix(1);
+        }
+        if(line.empty()){
+            continue;
+        }
+        Student s;
+        if(!parseStudentCSV(line, s)){
+            if(at == 0){                                    // a header line
+                continue;
+            }
+            if(r.rejected++ == 0){
+                r.firstRejected = at;
+            }
+            continue;
+        }
+        emit(std::move(s));
+        r.imported++;
+    }
+}
+
+// Parse the binary records [begin, end)
+template <class F>
+void StudentFile::parseBinary(unsigned long begin, unsigned long end, F emit, ImportResult& r) const{
+    for(unsigned long i = begin; i < end; i++){
+        BinaryStudent s;
+        memcpy(&s, this->data + 8 + i * sizeof(BinaryStudent), sizeof(s));
+        double gpa = s.gpa / 100.0;
+        if(s.nameLength > BINARY_NAME_BYTES || !validStudent(std::string_view(s.id, 10), s.age, gpa)){
+            if(r.rejected++ == 0){
+                r.firstRejected = 8 + i * sizeof(BinaryStudent);
+            }
+            continue;
+        }
+        emit(Student(string(s.name, s.nameLength), string(s.id, 10), s.age, gpa));
+        r.imported++;
+    }
+}
+
+// Parse the whole file, one contiguous slice per thread, calling emit(thread, Student&&) for every valid record
+template <class F>
+ImportResult StudentFile::parse(unsigned int threads, F emit) const{
+    ImportResult total;
+    if(this->data == nullptr){
+        return total;
+    }
+    total.opened = true;
+    total.bytes = this->bytes;
+    unsigned long units = this->binary ? (this->bytes - 8) / sizeof(BinaryStudent) : this->bytes;
+    std::vector<ImportResult> results(threads);
+    auto work = [&](unsigned int t){
+        unsigned long begin = units * t / threads;
+        unsigned long end = units * (t + 1) / threads;
+        auto emitHere = [&emit, t](Student&& s){ emit(t, std::move(s)); };
+        if(this->binary){
+            this->parseBinary(begin, end, emitHere, results[t]);
+        }
+        else{
+            this->parseCSV(begin, end, emitHere, results[t]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned int t = 1; t < threads; t++){
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for(std::thread& w : workers){
+        w.join();
+    }
+    for(const ImportResult& r : results){                   // slices are in file order, so the first rejection is too
+        if(r.rejected > 0 && total.rejected == 0){
+            total.firstRejected = r.firstRejected;
+        }
+        total.imported += r.imported;
+        total.rejected += r.rejected;
+    }
+    if(this->binary && (this->bytes - 8) % sizeof(BinaryStudent) != 0){   // a record cut short at the end
+        if(total.rejected++ == 0){
+            total.firstRejected = 8 + units * sizeof(BinaryStudent);
+        }
+    }
+    return total;
+}
+
+// Threads to use when the caller passes 0
+inline unsigned int importThreads(unsigned int threads){
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    return threads > 0 ? threads : 1;
+}
+
+/*
+ * Import a file into a HashMap keyed by ID: size the table for the
+ * whole file, parse on every thread into per-partition buffers, then
+ * link each partition into its own range of buckets.
+ */
+template <class Hash, class Eq, class Pool, class Range>
+ImportResult importInto(const std::string& path, HashMap<string, Student, Hash, Eq, Pool, Range>& table,
+                        unsigned int threads = 0){
+    using Table = HashMap<string, Student, Hash, Eq, Pool, Range>;
+    StudentFile file(path);
+    if(!file.isOpen()){
+        return ImportResult();
+    }
+    threads = importThreads(threads);
+    table.reserve(table.getCount() + file.estimateCount()); // fixes the bucket ranges of the partitions
+    const unsigned long parts = threads * 8;                // several per thread so uneven ranges even out
+    std::vector<std::vector<typename Table::BulkEntry>> buffers(threads * parts);
+    ImportResult r = file.parse(threads, [&table, &buffers, parts](unsigned int t, Student&& s){
+        unsigned long hash = table.hashKey(s.getID());
+        string id = s.getID();
+        buffers[t * parts + table.partitionOf(hash, parts)].push_back({std::move(id), std::move(s), hash});
+    });
+    table.insertPartitioned(buffers.data(), threads, parts, threads);
+    return r;
+}
+
+// Import a file into any table by handing every student to insert(Student&&), on this thread and in file order
+template <class Insert>
+ImportResult importEach(const std::string& path, Insert insert, unsigned int threads = 0){
+    StudentFile file(path);
+    threads = importThreads(threads);
+    std::vector<std::vector<Student>> parsed(threads);
+    ImportResult r = file.parse(threads, [&parsed](unsigned int t, Student&& s){
+        parsed[t].push_back(std::move(s));
+    });
+    for(std::vector<Student>& slice : parsed){
+        for(Student& s : slice){
+            insert(std::move(s));
+        }
+    }
+    return r;
+}
+
+#endif //IMPORTER_H
@@ -0,0 +1,189 @@
+/****************************************************************
+ * Node allocators for HashMap.
+ *
+ * HashMap gets the memory for its nodes from a Pool policy:
+ *   void *allocate(std::size_t bytes);
+ *   void deallocate(void *p, std::size_t bytes);
+ *   static constexpr bool bulkRelease;
+ *   static constexpr bool threadSafe;
+ * When bulkRelease is true the pool frees all of its memory when
+ * it is destroyed, so the table only has to run node destructors
+ * on teardown instead of handing every node back one at a time.
+ * threadSafe says whether several threads may allocate at once
+ * (HashMap::insertPartitioned builds with one thread otherwise).
+ *
+ * HeapPool is plain new/delete, one malloc per node. SlabPool
+ * carves nodes out of large slabs, reuses freed nodes through a
+ * free list and can back its slabs with huge pages, so a bulk load
+ * is a pointer bump per node and teardown is one munmap per slab.
+ ****************************************************************/
+
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <cstddef>      // std::size_t, std::max_align_t
+#include <new>          // ::operator new / delete
+#include <vector>       // list of slabs owned by a SlabPool
+#include <sys/mman.h>   // mmap backed slabs
+
+#define SLAB_BYTES (2UL << 20)  // 2 MiB per slab, one huge page on x86-64
+
+// One malloc and free per node
+struct HeapPool {
+    static constexpr bool bulkRelease = false;
+    static constexpr bool threadSafe = true;                // malloc is
+    void *allocate(std::size_t bytes){ return ::operator new(bytes); }
+    void deallocate(void *p, std::size_t){ ::operator delete(p); }
+    unsigned long memoryUsage() const{ return 0; }          // nodes are counted by the table itself
+};
+
+/**********************************************
+ * SlabPool class contents by section:
+ * 1. SlabPool class private data members
+ * 2. SlabPool private helper prototypes
+ * 3. SlabPool constructor/destructor prototypes
+ * 4. SlabPool class method prototypes
+ *
+ * Every object handed out by a pool is expected to
+ * be the same size (the first size it is asked for).
+ * Other sizes are passed through to the heap.
+ **********************************************/
+class SlabPool {
+private:
+    // 1.
+    struct FreeNode {
+        FreeNode *next;                                     // freed objects are chained through their first bytes
+    };
+    std::vector<void *> slabs;                              // every slab mapped so far
+    char *cursor;                                           // next unused byte of the newest slab
+    char *end;                                              // one past the newest slab
+    FreeNode *freeList;                                     // objects handed back for reuse
+    std::size_t objectSize;                                 // size of every object (0 until the first allocation)
+    bool hugePages;                                         // back new slabs with huge pages
+
+    // 2.
+    void *mapSlab();                                        // map one SLAB_BYTES slab
+    void addSlab();                                         // start carving objects out of a fresh slab
+
+public:
+    // 3.
+    explicit SlabPool(bool hugePages = false);
+    ~SlabPool();                                            // unmaps every slab at once
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // 4.
+    static constexpr bool bulkRelease = true;
+    static constexpr bool threadSafe = false;               // the cursor and free list aren't locked
+    void *allocate(std::size_t bytes);                      // pop the free list or bump the cursor
+    void deallocate(void *p, std::size_t bytes);            // push the object onto the free list
+    void setHugePages(bool on);                             // applies to slabs mapped from now on
+    unsigned long memoryUsage() const;                      // bytes of slab memory mapped
+};
+
+// SlabPool constructor, nothing is mapped until the first allocation
+inline SlabPool::SlabPool(bool hugePages){
+    this->cursor = nullptr;
+    this->end = nullptr;
+    this->freeList = nullptr;
+    this->objectSize = 0;
+    this->hugePages = hugePages;
+}
+
+// SlabPool destructor
+inline SlabPool::~SlabPool(){
+    for(void *slab : this->slabs){
+        munmap(slab, SLAB_BYTES);
+    }
+}
+
+// Map one slab, on a huge page if asked to and the system allows it
+inline void *SlabPool::mapSlab(){
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *slab = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if(this->hugePages){                                    // reserved huge pages (vm.nr_hugepages) first
+        slab = mmap(nullptr, SLAB_BYTES, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if(slab == MAP_FAILED && this->hugePages){
+        // otherwise ask for a transparent huge page, which needs a 2 MiB aligned range:
+        // map twice the size and trim the unaligned head and tail
+        char *raw = static_cast<char *>(mmap(nullptr, 2 * SLAB_BYTES, PROT_READ | PROT_WRITE, flags, -1, 0));
+        if(raw != MAP_FAILED){
+            auto address = reinterpret_cast<unsigned long>(raw);
+            char *aligned = raw + ((SLAB_BYTES - address % SLAB_BYTES) % SLAB_BYTES);
+            if(aligned != raw){
+                munmap(raw, aligned - raw);
+            }
+            munmap(aligned + SLAB_BYTES, raw + 2 * SLAB_BYTES - (aligned + SLAB_BYTES));
+            slab = aligned;
+#if defined(MADV_HUGEPAGE)
+            madvise(slab, SLAB_BYTES, MADV_HUGEPAGE);
+#endif
+        }
+    }
+    if(slab == MAP_FAILED){
+        slab = mmap(nullptr, SLAB_BYTES, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+    if(slab == MAP_FAILED){
+        throw std::bad_alloc();
+    }
+    return slab;
+}
+
+// Start carving objects out of a fresh slab
+inline void SlabPool::addSlab(){
+    void *slab = this->mapSlab();
+    this->slabs.push_back(slab);
+    this->cursor = static_cast<char *>(slab);
+    this->end = this->cursor + SLAB_BYTES;
+}
+
+// Hand out one object, reusing a freed one when there is one
+inline void *SlabPool::allocate(std::size_t bytes){
+    const std::size_t align = alignof(std::max_align_t);
+    bytes = (bytes + align - 1) / align * align;            // keep every object aligned for any member type
+    if(this->objectSize == 0){
+        this->objectSize = bytes < sizeof(FreeNode) ? sizeof(FreeNode) : bytes;
+    }
+    if(bytes > this->objectSize || this->objectSize > SLAB_BYTES){
+        return ::operator new(bytes);                       // not the size this pool carves
+    }
+    if(this->freeList != nullptr){
+        FreeNode *node = this->freeList;
+        this->freeList = node->next;
+        return node;
+    }
+    if(this->cursor == nullptr || this->end - this->cursor < static_cast<std::ptrdiff_t>(this->objectSize)){
+        this->addSlab();
+    }
+    void *p = this->cursor;
+    this->cursor += this->objectSize;
+    return p;
+}
+
+// Take an object back for reuse
+inline void SlabPool::deallocate(void *p, std::size_t bytes){
+    const std::size_t align = alignof(std::max_align_t);
+    bytes = (bytes + align - 1) / align * align;
+    if(bytes > this->objectSize || this->objectSize > SLAB_BYTES){
+        ::operator delete(p);
+        return;
+    }
+    auto *node = static_cast<FreeNode *>(p);
+    node->next = this->freeList;
+    this->freeList = node;
+}
+
+// Turn huge page backing on or off for slabs mapped from now on
+inline void SlabPool::setHugePages(bool on){
+    this->hugePages = on;
+}
+
+// Bytes of slab memory mapped by this pool
+inline unsigned long SlabPool::memoryUsage() const{
+    return this->slabs.size() * SLAB_BYTES;
+}
+
+#endif //NODEPOOL_H
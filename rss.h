@@ -0,0 +1,37 @@
+/****************************************************************
+ * Process memory measurement for the footprint reports.
+ ****************************************************************/
+
+#ifndef RSS_H
+#define RSS_H
+
+#include <fstream>      // reads /proc/self/statm
+#include <unistd.h>     // sysconf page size
+#if defined(__GLIBC__)
+#include <malloc.h>     // malloc_trim between measurements
+#endif
+
+// Resident set size of this process in bytes
+inline unsigned long residentBytes(){
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// Return freed memory to the system so the next RSS measurement starts clean
+inline void trimHeap(){
+#if defined(__GLIBC__)
+    mallopt(M_MMAP_THRESHOLD, 1 << 20);     // a fixed threshold keeps big tables in their own mappings, so the
+                                            // arrays dropped while growing don't linger in the RSS
+    malloc_trim(0);
+#endif
+}
+
+// Physical memory of the machine in bytes
+inline unsigned long physicalBytes(){
+    return static_cast<unsigned long>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+}
+
+#endif //RSS_H
@@ -0,0 +1,622 @@
+/****************************************************************
+ * Self-checks for the engines.
+ *
+ * Each check drives one engine through the situations that have
+ * broken it before and compares every answer with what a plain
+ * reference says it must be. A failed expectation is printed with
+ * the check it belongs to, and the program exits nonzero if any
+ * failed, so "make check" can gate a change.
+ *
+ * Build and run with: make check
+ ****************************************************************/
+
+#include <cstdio>             // report output
+#include <string>
+#include <vector>
+#include <algorithm>          // std::count
+#include <cmath>              // std::fabs
+#include <cstddef>            // offsetof
+#include <cstring>            // memcpy
+#include <thread>             // clients of the sharded map
+#include <chrono>
+#include <unistd.h>           // getpid, unlink
+#include "student.h"          // Student records and StudentMap
+#include "flathashmap.h"      // the open addressing engine
+#include "compactstudent.h"   // 8 byte records keyed by integer ID
+#include "generator.h"        // seeded synthetic students
+#include "frozenmap.h"        // read-only tables over a minimal perfect hash
+#include "bloomfilter.h"      // Bloom filtered tables
+#include "exporter.h"         // exportTable/exportFile, and importInto through importer.h
+#include "shardedmap.h"       // tables owned by worker threads behind queues
+#include "columnar.h"         // age and GPA columns of a table
+#include "snapshot.h"         // memory mapped snapshot files
+
+using std::vector;
+
+static const char *current = "";                            // the check being run, for failure messages
+static unsigned long failures = 0;
+
+/***************************
+ * Static methods to be used
+ ***************************/
+static void expect(bool ok, const char *what);              // count and print a failed expectation
+static string readFile(const string& path);                 // a whole file, empty if it can't be read
+static void checkMigration();                               // find/erase on duplicate keys while buckets migrate
+static void checkFlatPut();                                 // both engines return the newest value of a key put twice
+static void checkCompactPut();                              // a compact record put again is overwritten, not duplicated
+static void checkFreeze();                                  // a frozen map answers exactly what HashMap::find does
+static void checkBloom();                                   // the filter never turns away a key that was put
+static void checkSnapshot();                                // a snapshot serves what find() returned before saving
+static void checkExport();                                  // every export format imports back to the same table
+static void checkColumns();                                 // column kernels count each student once, as find() sees it
+static void checkSharded();                                 // operations sent through the shard queues all come back right
+
+/*******************
+ * MAIN METHOD BEGIN
+ *******************/
+int main() {
+    struct { const char *name; void (*run)(); } checks[] = {
+        {"migration with duplicates", checkMigration},
+        {"flat and chained re-puts", checkFlatPut},
+        {"compact re-puts", checkCompactPut},
+        {"freeze agrees with find", checkFreeze},
+        {"no Bloom false negatives", checkBloom},
+        {"snapshot round trip", checkSnapshot},
+        {"export/import round trip", checkExport},
+        {"columns agree with find", checkColumns},
+        {"sharded queues", checkSharded},
+    };
+    for(auto& c : checks){
+        unsigned long before = failures;
+        current = c.name;
+        c.run();
+        printf("%-32s %s\n", c.name, failures == before ? "ok" : "FAILED");
+    }
+    return failures == 0 ? 0 : 1;
+}
+/*****************
+ * MAIN METHOD END
+ *****************/
+
+// Count a failed expectation and say which check it came from
+static void expect(bool ok, const char *what){
+    if(!ok){
+        printf("%s: %s\n", current, what);
+        failures++;
+    }
+}
+
+// Read all of path
+static string readFile(const string& path){
+    string contents;
+    FILE *f = fopen(path.c_str(), "rb");
+    if(f == nullptr){
+        return contents;
+    }
+    char buffer[65536];
+    std::size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0){
+        contents.append(buffer, n);
+    }
+    fclose(f);
+    return contents;
+}
+
+/*
+ * Put every key twice, then erase it once, growing the table the
+ * whole time, so keys are shadowed and erased while they still sit
+ * in unmigrated old buckets. find() (both overloads) must always
+ * see the newest value, erase() must remove that one, and neither
+ * may change when the migration finishes.
+ */
+static void checkMigration(){
+    const long n = 2000;
+    HashMap<string, long, StringHash, StringEq> table(7);
+    const auto& constTable = table;                         // the const find() never migrates
+    auto key = [](long i){ return "key" + std::to_string(i); };
+    auto sees = [&](long i, long value){
+        const long *a = table.find(key(i));
+        const long *b = constTable.find(key(i));
+        return a != nullptr && b != nullptr && *a == value && *b == value;
+    };
+    bool rehashed = false;
+
+    for(long i = 0; i < n; i++){
+        table.put(key(i), i);
+    }
+    for(long i = 0; i < n; i++){                            // shadow every key, checking old and new copies around it
+        table.put(key(i), n + i);
+        rehashed = rehashed || table.isRehashing();
+        expect(sees(i, n + i), "find() misses the newest of two entries");
+        expect(sees(i / 2, n + i / 2), "an older duplicate resurfaced");
+        expect(i + 1 == n || sees(i + 1, i + 1), "a key not yet shadowed changed");
+    }
+    for(long i = 0; i < n; i++){                            // keep growing with fresh keys while erasing the newest copies
+        table.put("fresh" + std::to_string(i), i);
+        rehashed = rehashed || table.isRehashing();
+        expect(table.erase(key(i)), "erase() missed a present key");
+        expect(sees(i, i), "erase() didn't uncover the older entry");
+    }
+    expect(rehashed, "the table never grew while being checked");
+    table.finishRehash();
+    bool same = true;
+    for(long i = 0; i < n; i++){
+        same = same && sees(i, i);
+    }
+    expect(same, "finishing the migration changed what find() sees");
+    for(long i = 0; i < n; i++){
+        expect(table.erase(key(i)) && constTable.find(key(i)) == nullptr, "the last copy of a key wasn't erased");
+    }
+    expect(table.getCount() == static_cast<unsigned long>(n), "count is off after erasing");
+}
+
+/*
+ * Put the same keys into both engines, then put some of them again
+ * with new values (growing both tables in between): find() must
+ * return the newest value in each, and the flat table must keep one
+ * slot per key.
+ */
+static void checkFlatPut(){
+    const long n = 5000;
+    HashMap<string, long, StringHash, StringEq> chained(7);
+    FlatHashMap<string, long, StringHash, StringEq> flat(7);
+    auto key = [](long i){ return "key" + std::to_string(i); };
+    for(long round = 0; round < 3; round++){
+        for(long i = 0; i < n; i += round + 1){             // every key, then every second one, then every third
+            chained.put(key(i), round * n + i);
+            flat.put(key(i), round * n + i);
+        }
+    }
+    bool same = true;
+    for(long i = 0; i < n; i++){
+        const long *a = chained.find(key(i));
+        const long *b = flat.find(key(i));
+        long newest = i % 3 == 0 ? 2 * n + i : i % 2 == 0 ? n + i : i;
+        same = same && a != nullptr && b != nullptr && *a == newest && *b == newest;
+    }
+    expect(same, "the engines disagree on a key that was put again");
+    expect(flat.getCount() == static_cast<unsigned long>(n), "the flat table keeps more than one slot for a key");
+    unsigned long slots = 0;
+    flat.forEach([&slots](const string&, long){ slots++; });
+    expect(slots == static_cast<unsigned long>(n), "the flat table holds a stale slot");
+}
+
+/*
+ * Put generated students into a compact table, then put every other
+ * one again with a new name, age and GPA: find() must return the new
+ * record and the table must hold one record per ID.
+ */
+static void checkCompactPut(){
+    const unsigned long n = 20000;
+    StudentGenerator generator(19);
+    vector<Student> students;
+    generator.generate(n, students);
+    CompactStudentTable table(7);
+    for(const Student& s : students){
+        table.put(s.getName(), s.getID(), s.getAge(), s.getGPA());
+    }
+    for(unsigned long i = 0; i < n; i += 2){
+        students[i].setName("Renamed");
+        students[i].setAge(students[i].getAge() + 1);
+        students[i].setGPA(1.25);
+        table.put(students[i].getName(), students[i].getID(), students[i].getAge(), students[i].getGPA());
+    }
+    expect(table.getCount() == n, "the compact table keeps more than one record for an ID");
+    bool same = true;
+    for(const Student& s : students){
+        const CompactStudent *c = table.find(s.getID());
+        same = same && c != nullptr && table.getName(*c) == s.getName() && c->age == s.getAge() &&
+               c->gpa == static_cast<uint16_t>(s.getGPA() * 100 + 0.5);
+    }
+    expect(same, "the compact table returns an older record");
+}
+
+/*
+ * Freeze a table in which some students were put twice (the older
+ * copy shadowed, possibly still in an old bucket) on one thread and
+ * on two, and ask both maps about every ID and about IDs that were
+ * never put: the frozen map must return the same student find()
+ * does, hold each key once and know nothing else.
+ */
+static void checkFreeze(){
+    const unsigned long n = 30000;
+    StudentGenerator generator(7);
+    vector<Student> students;
+    generator.generate(n, students);
+    StudentMap table(97);
+    for(const Student& s : students){
+        table.put(s.getID(), s);
+    }
+    for(unsigned long i = 0; i < n; i += 3){                // shadow every third student with a different age
+        Student older = students[i];
+        students[i].setAge(older.getAge() + 1);
+        table.put(students[i].getID(), students[i]);
+    }
+    const StudentMap& constTable = table;
+    for(unsigned int threads : {1u, 2u}){
+        FrozenHashMap<string, Student, WyHash, StringEq> frozen;
+        expect(frozen.freeze(table, threads), "freeze() failed");
+        expect(frozen.getCount() == n, "the frozen map doesn't hold every key exactly once");
+        bool same = true;
+        for(const Student& s : students){
+            const Student *a = constTable.find(s.getID());
+            const Student *b = frozen.find(s.getID());
+            same = same && a != nullptr && b != nullptr && a->getAge() == s.getAge() && b->getAge() == s.getAge() &&
+                   b->getName() == a->getName();
+        }
+        expect(same, "the frozen map and find() disagree on a student");
+        bool absent = true;
+        for(unsigned long i = 0; i < n; i++){
+            string id = students[i].getID();
+            id[0] = '8';                                    // generated IDs all start with 9
+            absent = absent && frozen.find(id) == nullptr;
+        }
+        expect(absent, "the frozen map found an ID that was never put");
+    }
+}
+
+/*
+ * Grow a filtered table from a tiny filter, so the filter is rebuilt
+ * for twice the count again and again, then bulk load past it, erase
+ * half the keys and rebuild: after each step every key still in the
+ * table must pass the filter and be found, and misses must be turned
+ * away at roughly the configured rate.
+ */
+static void checkBloom(){
+    const long n = 20000;
+    FilteredHashMap<string, long, StringHash, StringEq> table(7, 0.01);
+    auto key = [](long i){ return "key" + std::to_string(i); };
+    auto allFound = [&](long from, long to){
+        bool found = true;
+        for(long i = from; i < to; i++){
+            const long *v = table.find(key(i));
+            found = found && table.mayContain(key(i)) && v != nullptr && *v == i;
+        }
+        return found;
+    };
+    unsigned long rebuilds = 0;
+
+    for(long i = 0; i < n; i++){
+        unsigned long capacity = table.getFilter().getCapacity();
+        table.put(key(i), i);
+        if(table.getFilter().getCapacity() != capacity){    // the filter was just rebuilt from the nodes
+            rebuilds++;
+            expect(allFound(0, i + 1), "a key was lost when the filter grew");
+        }
+    }
+    expect(rebuilds > 5, "the filter never had to grow");
+    expect(allFound(0, n), "a key put is turned away by the filter");
+
+    table.bulkLoad([&](auto& t){
+        for(long i = n; i < 4 * n; i++){
+            t.put(key(i), i);
+        }
+    });
+    expect(table.getFilter().getCapacity() >= table.getCount(), "bulkLoad() didn't size the filter for the table");
+    expect(allFound(0, 4 * n), "a bulk loaded key is turned away by the filter");
+
+    for(long i = 0; i < 4 * n; i += 2){
+        expect(table.erase(key(i)), "erase() missed a present key");
+    }
+    table.rebuildFilter();
+    bool gone = true;
+    for(long i = 0; i < 4 * n; i += 2){
+        gone = gone && table.find(key(i)) == nullptr;
+    }
+    expect(gone, "an erased key is still found");
+    bool kept = true;
+    for(long i = 1; i < 4 * n; i += 2){
+        const long *v = table.find(key(i));
+        kept = kept && table.mayContain(key(i)) && v != nullptr && *v == i;
+    }
+    expect(kept, "a key kept through erase() and rebuildFilter() is turned away");
+
+    unsigned long passed = 0;
+    for(long i = 0; i < n; i++){
+        passed += table.mayContain("miss" + std::to_string(i));
+    }
+    expect(passed < n / 20, "the filter passes far more misses than its false positive rate");
+}
+
+/*
+ * Save a table in which every third student was put again with a new
+ * name and age while the table was still growing, map the file and
+ * look up every ID: the snapshot must hold each student once, as the
+ * record find() returned before saving. Then damage a copy of the
+ * file: a bad header must be refused by open(), a bad bucket offset
+ * or name offset must be caught by verify() and by the lookups that
+ * meet it, without reading outside the mapping.
+ */
+static void checkSnapshot(){
+    const unsigned long n = 30000;
+    StudentGenerator generator(17);
+    vector<Student> students;
+    generator.generate(n, students);
+    StudentMap table(97);
+    for(const Student& s : students){
+        table.put(s.getID(), s);
+    }
+    for(unsigned long i = 0; i < n; i += 3){
+        students[i].setName(students[i].getName() + " II");
+        students[i].setAge(students[i].getAge() + 1);
+        table.put(students[i].getID(), students[i]);
+    }
+    while(!table.isRehashing()){                            // grow, then put students again while their old copies
+        students.push_back(generator.nextStudent());        // still wait in unmigrated buckets
+        table.put(students.back().getID(), students.back());
+    }
+    for(unsigned long i = n - 1; i >= 7 && table.isRehashing(); i -= 7){
+        students[i].setAge(students[i].getAge() + 2);
+        table.put(students[i].getID(), students[i]);
+    }
+    expect(table.isRehashing(), "the table finished growing before it was saved");
+    string path = "/tmp/selfcheck-" + std::to_string(getpid()) + ".snap";
+    StudentSnapshot snapshot;
+    expect(StudentSnapshot::write(path, table), "write() failed");
+    expect(snapshot.open(path), "open() rejected a snapshot it wrote");
+    expect(snapshot.getCount() == students.size(), "the snapshot doesn't hold each student once");
+    bool same = true;
+    for(const Student& s : students){
+        const SnapshotRecord *r = snapshot.find(s.getID());
+        same = same && r != nullptr && r->getName() == s.getName() && r->getAge() == s.getAge() &&
+               r->getGPA() == s.getGPA();
+    }
+    expect(same, "the snapshot returns an older record than find() did");
+    expect(snapshot.verify(), "verify() rejected a snapshot write() made");
+
+    string file = readFile(path);
+    string bad = path + ".bad";                             // a new file, so no map of the good one sees the damage
+    SnapshotHeader h;
+    memcpy(&h, file.data(), sizeof(h));
+    auto damaged = [&](unsigned long at, uint64_t value){  // a copy of the file with one 8 byte field overwritten
+        string copy = file;
+        memcpy(&copy[at], &value, sizeof(value));
+        unlink(bad.c_str());
+        FILE *out = fopen(bad.c_str(), "wb");
+        fwrite(copy.data(), 1, copy.size(), out);
+        fclose(out);
+    };
+    damaged(offsetof(SnapshotHeader, count), h.count + 1);
+    expect(!StudentSnapshot().open(bad), "open() accepted a header whose count doesn't match");
+
+    uint64_t b = NumericIDHash()(students[0].getID()) & (h.buckets - 1);
+    damaged(h.offsetsAt + (b + 1) * sizeof(uint64_t), 1UL << 60);
+    StudentSnapshot badOffset;
+    expect(badOffset.open(bad), "open() read past the header");
+    expect(!badOffset.verify(), "verify() missed a bucket offset past the records");
+    expect(badOffset.find(students[0].getID()) == nullptr, "a lookup followed a bucket offset past the records");
+
+    damaged(h.recordsAt + offsetof(SnapshotRecord, nameOffset), 1UL << 40);
+    StudentSnapshot badName;
+    expect(badName.open(bad), "open() read past the header");
+    expect(!badName.verify(), "verify() missed a name outside the file");
+    unsigned long visited = 0;
+    badName.forEach([&visited](std::string_view, const SnapshotRecord& r){ visited += r.getName().length() > 0; });
+    expect(visited == students.size() - 1, "forEach() handed out a record whose name is outside the file");
+    bool safe = true;
+    for(const Student& s : students){
+        const SnapshotRecord *r = badName.find(s.getID());
+        safe = safe && (r == nullptr || r->getName() == s.getName());
+    }
+    expect(safe, "a lookup returned a record whose name is outside the file");
+    unlink(path.c_str());
+    unlink(bad.c_str());
+}
+
+/*
+ * Export a table holding shadowed students and names that need
+ * quoting as CSV and as binary, on one thread and on two, and import
+ * each file into an empty table: the outputs must not depend on the
+ * thread count, each student must be written once (the one find()
+ * returns) and come back with the same name, ID, age and GPA to the
+ * hundredth. A binary file with a partial record appended must
+ * reject just that record, at its offset. JSON has no importer, so
+ * only its row count is checked.
+ */
+static void checkExport(){
+    const unsigned long n = 40000;
+    StudentGenerator generator(11);
+    vector<Student> students;
+    generator.generate(n, students);
+    students.push_back(Student("Last, First", "0000000001", 30, 3.456));
+    students.push_back(Student("\"Quoted\" \\ name", "0000000002", 18, 0));
+    students.push_back(Student("Top", "0000000003", 99, 4.0));
+    StudentMap table(97);
+    for(const Student& s : students){
+        table.put(s.getID(), s);
+    }
+    for(unsigned long i = 0; i < n; i += 4){                // shadow every fourth student with a new name and GPA
+        students[i].setName(students[i].getName() + " Jr");
+        students[i].setGPA(4.0 - students[i].getGPA());
+        table.put(students[i].getID(), students[i]);
+    }
+    const unsigned long distinct = students.size();
+    const string base = "/tmp/selfcheck-" + std::to_string(getpid());
+
+    for(const char *ext : {".csv", ".bin"}){
+        string one = base + "-1" + ext, two = base + "-2" + ext;
+        ExportResult r1 = exportFile(table, one, 1);
+        ExportResult r2 = exportFile(table, two, 2);
+        expect(r1.written && r2.written, "an export failed to write");
+        expect(r1.rows == distinct && r2.rows == distinct && r1.skipped == 0, "an export didn't write each student once");
+        expect(readFile(one) == readFile(two), "the export depends on the thread count");
+
+        StudentMap imported(11);
+        ImportResult in = importInto(one, imported, 2);
+        expect(in.opened && in.rejected == 0, "an exported file didn't import cleanly");
+        expect(in.imported == distinct && imported.getCount() == distinct, "the import didn't bring back every student");
+        bool same = true;
+        for(const Student& s : students){
+            const Student *a = imported.find(s.getID());
+            same = same && a != nullptr && a->getName() == s.getName() && a->getAge() == s.getAge() &&
+                   std::fabs(a->getGPA() - s.getGPA()) < 0.0051;
+        }
+        expect(same, "a student came back different from the one find() returns");
+        if(string(ext) == ".bin"){
+            unsigned long whole = readFile(one).size();
+            FILE *f = fopen(one.c_str(), "ab");
+            expect(f != nullptr && fwrite("0000000004", 1, 10, f) == 10 && fclose(f) == 0, "couldn't cut a record short");
+            StudentMap cut(11);
+            in = importInto(one, cut, 2);
+            expect(in.imported == distinct && in.rejected == 1 && in.firstRejected == whole,
+                   "a partial record at the end wasn't rejected at its offset");
+        }
+        unlink(one.c_str());
+        unlink(two.c_str());
+    }
+
+    string json = base + ".json";
+    ExportResult r = exportFile(table, json, 2);
+    expect(r.written && r.rows == distinct, "the JSON export didn't write each student once");
+    unlink(json.c_str());
+}
+
+/*
+ * Several client threads put disjoint keys into a sharded map (half
+ * of them twice), then other clients look up every key and some
+ * that were never put, tagging each operation with its key's index.
+ * Every operation must come back exactly once with its tag, puts
+ * must report whether the key was already there, finds must return
+ * the newest value, and the shards must settle on the right count.
+ */
+static void checkSharded(){
+    using Sharded = ShardedHashMap<string, long, StringHash, StringEq>;
+    const unsigned int threads = 3;
+    const long perThread = 20000;
+    const long n = threads * perThread;
+    auto key = [](long i){ return "key" + std::to_string(i); };
+    auto value = [n](long i){ return i % 2 == 0 ? n + i : i; };   // even keys are put a second time
+    Sharded map(2, 97, false);
+    vector<vector<char>> seen(threads, vector<char>(2 * n, 0));
+    vector<unsigned long> wrong(threads, 0);
+
+    vector<std::thread> writers;
+    for(unsigned int t = 0; t < threads; t++){
+        writers.emplace_back([&, t](){
+            Sharded::Client *client = map.connect();
+            auto done = [&](const Sharded::Op& op){
+                long i = static_cast<long>(op.tag % n);
+                bool again = op.tag >= static_cast<unsigned long>(n);
+                wrong[t] += op.kind != Sharded::PUT || op.key != key(i) || op.found != again;
+                seen[t][op.tag]++;
+            };
+            for(long i = t * perThread; i < (t + 1) * perThread; i++){
+                client->put(key(i), i, i);
+                client->poll(done);
+            }
+            client->drain(done);
+            for(long i = t * perThread; i < (t + 1) * perThread; i += 2){
+                client->put(key(i), n + i, n + i);
+            }
+            client->drain(done);
+        });
+    }
+    for(std::thread& w : writers){
+        w.join();
+    }
+    bool once = true;
+    for(unsigned int t = 0; t < threads; t++){
+        for(long i = t * perThread; i < (t + 1) * perThread; i++){
+            once = once && seen[t][i] == 1 && seen[t][n + i] == (i % 2 == 0);
+        }
+    }
+    expect(once, "a put didn't come back exactly once with its tag");
+
+    for(vector<char>& s : seen){
+        std::fill(s.begin(), s.end(), 0);
+    }
+    vector<std::thread> readers;
+    for(unsigned int t = 0; t < threads; t++){
+        readers.emplace_back([&, t](){
+            Sharded::Client *client = map.connect();
+            auto done = [&](const Sharded::Op& op){
+                long i = static_cast<long>(op.tag);
+                bool present = i < n;
+                wrong[t] += op.kind != Sharded::FIND || op.found != present || (present && op.value != value(i));
+                seen[t][op.tag]++;
+            };
+            for(long i = 0; i < 2 * n; i++){                // every key, then as many that were never put
+                client->find(key(i), i);
+                client->poll(done);
+            }
+            client->drain(done);
+        });
+    }
+    for(std::thread& r : readers){
+        r.join();
+    }
+    once = true;
+    unsigned long errors = 0;
+    for(unsigned int t = 0; t < threads; t++){
+        once = once && std::count(seen[t].begin(), seen[t].end(), 1) == 2 * n;
+        errors += wrong[t];
+    }
+    expect(once, "a find didn't come back exactly once with its tag");
+    expect(errors == 0, "an operation came back with the wrong key, value or found flag");
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(map.getCount() != static_cast<unsigned long>(n) && std::chrono::steady_clock::now() < deadline){
+        std::this_thread::yield();                          // shards publish their count after answering a batch
+    }
+    expect(map.getCount() == static_cast<unsigned long>(n), "the shards don't hold every key exactly once");
+}
+
+/*
+ * Build columns from a table where every fifth student was put again
+ * with a new age and GPA, and compare the kernels (scalar and AVX2,
+ * on one thread and two) with the same filter applied to what find()
+ * returns for each ID: a student put twice counts once, newest first.
+ */
+static void checkColumns(){
+    const unsigned long n = 20000;
+    StudentGenerator generator(13);
+    vector<Student> students;
+    generator.generate(n, students);
+    StudentMap table(97);
+    for(const Student& s : students){
+        table.put(s.getID(), s);
+    }
+    for(unsigned long i = 0; i < n; i += 5){
+        students[i].setAge(students[i].getAge() % 40 + 18);
+        students[i].setGPA(4.0 - students[i].getGPA());
+        table.put(students[i].getID(), students[i]);
+    }
+
+    ColumnFilter f;
+    f.ageLo = 20;
+    f.ageHi = 30;
+    f.gpaLo = 1.0f;
+    f.gpaHi = 3.5f;
+    ColumnAggregate want;
+    AgeGroups wantGroups;
+    const StudentMap& constTable = table;
+    for(const Student& s : students){
+        const Student *found = constTable.find(s.getID());
+        float gpa = static_cast<float>(found->getGPA());
+        if(found->getAge() >= f.ageLo && found->getAge() <= f.ageHi && gpa >= f.gpaLo && gpa <= f.gpaHi){
+            ColumnAggregate one;
+            one.count = 1;
+            one.gpaSum = gpa;
+            one.gpaMin = one.gpaMax = gpa;
+            want.merge(one);
+            wantGroups.count[found->getAge()]++;
+        }
+    }
+
+    StudentColumns columns;
+    columns.build(table, 2);
+    expect(columns.getCount() == n, "the columns don't hold each student once");
+    for(bool simd : {false, true}){
+        columns.useSIMD(simd);
+        for(unsigned int threads : {1u, 2u}){
+            ColumnAggregate got = columns.aggregate(f, threads);
+            expect(got.count == want.count && got.gpaMin == want.gpaMin && got.gpaMax == want.gpaMax &&
+                   std::fabs(got.gpaSum - want.gpaSum) < 1e-3 * want.count, "aggregate() disagrees with find()");
+            expect(columns.count(f, threads) == want.count, "count() disagrees with find()");
+            AgeGroups groups;
+            columns.groupByAge(f, groups, threads);
+            expect(std::equal(groups.count, groups.count + COLUMN_MAX_AGE + 1, wantGroups.count),
+                   "groupByAge() disagrees with find()");
+        }
+    }
+}
@@ -0,0 +1,440 @@
+/****************************************************************
+ * Command server for a Student table.
+ *
+ * StudentServer answers a line based text protocol, one response
+ * line per request line, in order:
+ *   GET id              VALUE name,id,age,gpa    or NOTFOUND
+ *   PUT name,id,age,gpa OK (inserted or replaced) or ERR invalid student
+ *   EXISTS id           1 or 0
+ *   DEL id              1 or 0
+ *   STATS               STATS entries=.. buckets=.. load=.. requests=..
+ *   QUIT                closes the connection
+ *   SHUTDOWN            stops a socket server once this read is answered
+ * PUT takes the same lines as a CSV import and validates them the
+ * same way (importer.h). Anything else gets ERR.
+ *
+ * It serves either a pair of file descriptors (stdin/stdout) or a
+ * Unix domain socket, where one thread multiplexes every client
+ * with poll(). Requests are pipelined: each read() takes up to
+ * SERVER_BUFFER bytes, every complete line in it is answered into
+ * an output buffer, and the answers go out with one write(), so a
+ * client sending many requests at once pays for a couple of system
+ * calls per batch rather than per request. Nothing is flushed per
+ * line. Numbers are formatted with std::to_chars.
+ *
+ * Socket clients are non-blocking: whatever a write() doesn't take
+ * stays in the connection's output, and the connection waits for
+ * POLLOUT instead of reading more until it is gone, so one client
+ * that stops reading can't stall the others.
+ *
+ * ServerClient is the other end for a Unix socket: it sends a
+ * buffer of requests and reads back a given number of response
+ * lines, polling for both at once and reading answers while the
+ * rest of the buffer is still going out. The server only reads
+ * from a client whose answers have been taken, so a client that
+ * wrote a deep pipeline before reading anything would wait on the
+ * server while the server waits on it. The load generator in
+ * benchmark.cpp uses it.
+ ****************************************************************/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>     // std::to_chars for the responses
+#include <cstring>      // memcpy/memset for socket addresses
+#include <cerrno>
+#include <unistd.h>     // read/write/close
+#include <fcntl.h>      // O_NONBLOCK for socket clients
+#include <poll.h>       // one thread waits on every client
+#include <sys/socket.h>
+#include <sys/un.h>     // Unix domain sockets
+#include "student.h"    // Student records and StudentMap
+#include "importer.h"   // parseStudentCSV for PUT
+
+#define SERVER_BUFFER 65536     // bytes taken per read() and output held before it is written
+#define SERVER_MAX_LINE 4096    // longest request line, a longer one closes the connection
+#define SERVER_BACKLOG 64       // pending connections the listening socket queues
+
+// Write all of data to fd, false if the descriptor fails
+inline bool writeAll(int fd, const char *data, std::size_t length){
+    while(length > 0){
+        ssize_t n = write(fd, data, length);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+// A sockaddr_un for path, false if the path is too long for one
+inline bool unixAddress(const std::string& path, sockaddr_un& address){
+    if(path.length() >= sizeof(address.sun_path)){
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.length() + 1);
+    return true;
+}
+
+/*************************************************
+ * StudentServer class contents by section:
+ * 1. StudentServer private types and data members
+ * 2. StudentServer private helper prototypes
+ * 3. StudentServer constructor prototype
+ * 4. StudentServer class method prototypes
+ *************************************************/
+class StudentServer {
+private:
+    // 1.
+    struct Connection {
+        int in;
+        int out;
+        std::string input;                                  // bytes read but not yet a complete line
+        std::string output;                                 // responses not yet written
+        bool blocking;                                      // false: write what the socket takes, keep the rest
+        bool closing;                                       // EOF, QUIT or a bad line: close once output is written
+    };
+    StudentMap& table;
+    unsigned long requests;
+    bool stopping;                                          // SHUTDOWN was received
+
+    // 2.
+    bool handle(std::string_view line, std::string& out);   // answer one request, false on QUIT
+    void receive(Connection& c);                            // read once and answer every complete line
+    bool flush(Connection& c);                              // write pending output, false if the descriptor failed
+
+public:
+    // 3.
+    explicit StudentServer(StudentMap& table);
+
+    // 4.
+    unsigned long getRequests() const;                      // requests answered so far
+    bool serveStream(int in, int out);                      // serve one descriptor pair until EOF or QUIT
+    bool serveSocket(const std::string& path);              // serve a Unix socket until SHUTDOWN, false on failure
+};
+
+// Server over table (puts replace the entry with the same ID)
+inline StudentServer::StudentServer(StudentMap& table) : table(table){
+    this->requests = 0;
+    this->stopping = false;
+}
+
+// Requests answered so far
+inline unsigned long StudentServer::getRequests() const{
+    return this->requests;
+}
+
+// Answer one request line into out, returns false when the client asked to close
+inline bool StudentServer::handle(std::string_view line, std::string& out){
+    this->requests++;
+    std::size_t space = line.find(' ');
+    std::string_view command = line.substr(0, space);
+    std::string_view arg = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+    char number[32];
+    if(command == "GET"){
+        const Student *s = this->table.find(arg);
+        if(s == nullptr){
+            out += "NOTFOUND\n";
+            return true;
+        }
+        out += "VALUE ";
+        out += s->getName();
+        out += ',';
+        out += s->getID();
+        out += ',';
+        out.append(number, std::to_chars(number, number + sizeof(number), s->getAge()).ptr);
+        out += ',';
+        out.append(number, std::to_chars(number, number + sizeof(number), s->getGPA(),
+                                         std::chars_format::fixed, 2).ptr);
+        out += '\n';
+    }
+    else if(command == "PUT"){
+        Student s;
+        if(!parseStudentCSV(arg, s)){
+            out += "ERR invalid student\n";
+            return true;
+        }
+        Student *existing = this->table.find(s.getID());
+        if(existing != nullptr){
+            *existing = std::move(s);
+        }
+        else{
+            string id = s.getID();
+            this->table.put(std::move(id), std::move(s));
+        }
+        out += "OK\n";
+    }
+    else if(command == "EXISTS"){
+        out += this->table.find(arg) != nullptr ? "1\n" : "0\n";
+    }
+    else if(command == "DEL"){
+        out += this->table.erase(arg) ? "1\n" : "0\n";
+    }
+    else if(command == "STATS"){
+        out += "STATS entries=";
+        out.append(number, std::to_chars(number, number + sizeof(number), this->table.getCount()).ptr);
+        out += " buckets=";
+        out.append(number, std::to_chars(number, number + sizeof(number), this->table.getSize()).ptr);
+        out += " load=";
+        out.append(number, std::to_chars(number, number + sizeof(number), this->table.getLoadFactor(),
+                                         std::chars_format::fixed, 3).ptr);
+        out += " requests=";
+        out.append(number, std::to_chars(number, number + sizeof(number), this->requests).ptr);
+        out += '\n';
+    }
+    else if(command == "QUIT"){
+        return false;
+    }
+    else if(command == "SHUTDOWN"){
+        this->stopping = true;
+        return false;
+    }
+    else{
+        out += "ERR unknown command\n";
+    }
+    return true;
+}
+
+// Read what is available and answer every complete line into the output, setting closing when the client is done
+inline void StudentServer::receive(Connection& c){
+    char buffer[SERVER_BUFFER];
+    ssize_t n = read(c.in, buffer, sizeof(buffer));
+    if(n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)){
+        return;
+    }
+    if(n > 0){
+        c.input.append(buffer, n);
+    }
+    bool open = n > 0;
+    std::size_t start = 0;
+    for(std::size_t nl; open && (nl = c.input.find('\n', start)) != string::npos; start = nl + 1){
+        std::string_view line(c.input.data() + start, nl - start);
+        if(!line.empty() && line.back() == '\r'){
+            line.remove_suffix(1);
+        }
+        open = this->handle(line, c.output);
+    }
+    c.input.erase(0, start);
+    if(open && c.input.size() > SERVER_MAX_LINE){
+        c.output += "ERR line too long\n";
+        open = false;
+    }
+    c.closing = !open;
+}
+
+// Write the pending output: all of it on a blocking descriptor, as much as a non-blocking socket takes otherwise
+inline bool StudentServer::flush(Connection& c){
+    if(c.blocking){
+        bool written = writeAll(c.out, c.output.data(), c.output.size());
+        c.output.clear();
+        return written;
+    }
+    std::size_t written = 0;
+    while(written < c.output.size()){
+        ssize_t n = send(c.out, c.output.data() + written, c.output.size() - written, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            break;                                          // the socket is full, wait for POLLOUT
+        }
+        if(n <= 0){
+            return false;
+        }
+        written += n;
+    }
+    c.output.erase(0, written);
+    return true;
+}
+
+// Serve requests from in, answering on out, until EOF or QUIT
+inline bool StudentServer::serveStream(int in, int out){
+    Connection c{in, out, string(), string(), true, false};
+    while(!c.closing){
+        this->receive(c);
+        if(!this->flush(c)){
+            break;
+        }
+    }
+    return true;
+}
+
+// Accept clients on a Unix socket at path and serve them all from this thread until one sends SHUTDOWN
+inline bool StudentServer::serveSocket(const std::string& path){
+    sockaddr_un address;
+    if(!unixAddress(path, address)){
+        return false;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0){
+        return false;
+    }
+    unlink(path.c_str());                                   // a socket file left behind by an earlier run
+    if(bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+       listen(listener, SERVER_BACKLOG) < 0){
+        close(listener);
+        return false;
+    }
+    std::vector<pollfd> fds{{listener, POLLIN, 0}};
+    std::vector<Connection> connections;                    // connections[i] is fds[i + 1]
+    while(!this->stopping){
+        if(poll(fds.data(), fds.size(), -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        for(std::size_t i = fds.size(); i-- > 1;){          // backwards, so closing one doesn't skip the next
+            Connection& c = connections[i - 1];
+            if(fds[i].revents == 0){
+                continue;
+            }
+            if(c.output.empty() && !c.closing){             // reads only once earlier answers are out
+                this->receive(c);
+            }
+            if(this->flush(c) && !(c.closing && c.output.empty())){
+                fds[i].events = c.output.empty() ? POLLIN : POLLOUT;
+            }
+            else{
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                connections.erase(connections.begin() + (i - 1));
+            }
+        }
+        if(fds[0].revents & POLLIN){
+            int client = accept(listener, nullptr, nullptr);
+            if(client >= 0 && fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK) < 0){
+                close(client);
+                client = -1;
+            }
+            if(client >= 0){
+                fds.push_back({client, POLLIN, 0});
+                connections.push_back(Connection{client, client, string(), string(), false, false});
+            }
+        }
+    }
+    for(std::size_t i = 1; i < fds.size(); i++){
+        this->flush(connections[i - 1]);                    // best effort, a client that stopped reading loses the rest
+        close(fds[i].fd);
+    }
+    close(listener);
+    unlink(path.c_str());
+    return true;
+}
+
+/*************************************************
+ * ServerClient class contents by section:
+ * 1. ServerClient class private data members
+ * 2. ServerClient constructor/destructor prototypes
+ * 3. ServerClient class method prototypes
+ *************************************************/
+class ServerClient {
+private:
+    // 1.
+    int fd;                                                 // -1 until connected
+    std::string input;                                      // bytes read past the last line handed out
+
+public:
+    // 2.
+    ServerClient();
+    ~ServerClient();
+    ServerClient(const ServerClient&) = delete;
+    ServerClient& operator=(const ServerClient&) = delete;
+
+    // 3.
+    bool connect(const std::string& path);
+    template <class F>
+    bool request(const std::string& requests, unsigned long lines, F visit);  // send, visiting (line) for each answer
+};
+
+// Unconnected client
+inline ServerClient::ServerClient(){
+    this->fd = -1;
+}
+
+// Close the connection
+inline ServerClient::~ServerClient(){
+    if(this->fd >= 0){
+        close(this->fd);
+    }
+}
+
+// Connect to the server listening at path
+inline bool ServerClient::connect(const std::string& path){
+    sockaddr_un address;
+    if(!unixAddress(path, address)){
+        return false;
+    }
+    this->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(this->fd < 0){
+        return false;
+    }
+    if(::connect(this->fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0){
+        close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+// Send a buffer of request lines and hand each of the next "lines" answers to visit, taking answers in as soon as
+// they arrive so a pipeline of any depth never leaves both ends waiting on a full socket buffer
+template <class F>
+bool ServerClient::request(const std::string& requests, unsigned long lines, F visit){
+    if(this->fd < 0){
+        return false;
+    }
+    char buffer[SERVER_BUFFER];
+    std::size_t sent = 0;
+    while(true){
+        std::size_t start = 0;
+        std::size_t nl;
+        while(lines > 0 && (nl = this->input.find('\n', start)) != string::npos){
+            visit(std::string_view(this->input.data() + start, nl - start));
+            start = nl + 1;
+            lines--;
+        }
+        this->input.erase(0, start);
+        if(lines == 0 && sent == requests.size()){
+            return true;
+        }
+        pollfd p{this->fd, static_cast<short>((lines > 0 ? POLLIN : 0) | (sent < requests.size() ? POLLOUT : 0)), 0};
+        if(poll(&p, 1, -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        if(p.revents & POLLIN){                             // answers first, they are what frees the server to read
+            ssize_t n = recv(this->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if(n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)){
+                continue;
+            }
+            if(n <= 0){
+                return false;
+            }
+            this->input.append(buffer, n);
+        }
+        else if(p.revents & (POLLERR | POLLHUP | POLLNVAL)){
+            return false;
+        }
+        if(p.revents & POLLOUT){
+            ssize_t n = send(this->fd, requests.data() + sent, requests.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if(n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK){
+                return false;
+            }
+            sent += n > 0 ? n : 0;
+        }
+    }
+}
+
+#endif //SERVER_H
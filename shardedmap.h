@@ -0,0 +1,527 @@
+/****************************************************************
+ * Shared-nothing hash map: one HashMap shard per worker thread.
+ *
+ * ShardedHashMap<Key, Value, Hash, Eq, Pool> splits the key space
+ * over N shards. Each shard is a plain single threaded HashMap
+ * owned by one worker thread (pinned to its own core when asked),
+ * and nothing but that thread ever touches it, so there are no
+ * locks and no shared cache lines on the data path at all.
+ *
+ * Client threads talk to the shards through messages:
+ *   - connect() hands out a Client. Each Client has one pair of
+ *     single producer/single consumer ring buffers (SpscQueue) per
+ *     shard, requests one way and responses the other, so every
+ *     queue has exactly one writer and one reader.
+ *   - Client::put() and Client::find() route the operation by hash
+ *     and append it to that shard's open batch. A batch is sent
+ *     when it holds SHARD_BATCH operations or on flush(), so one
+ *     queue push (and one cache line handoff) carries many ops.
+ *   - The worker runs the whole batch against its HashMap, writes
+ *     each result into the batch and sends it back.
+ *   - Client::poll() collects returned batches and hands every
+ *     completed operation, with the tag the caller gave it, to a
+ *     callback; drain() flushes and waits for all of them.
+ * Batches are recycled per client and shard, so steady state
+ * traffic allocates nothing but the keys and values themselves.
+ * A client that keeps sending without polling keeps allocating
+ * batches to hold the results it hasn't picked up.
+ *
+ * The shard is picked from the key's hash remixed through a fold
+ * multiply, so the choice doesn't line up with the bucket the
+ * shard's own table derives from the same hash. getCount() and
+ * load() aggregate per shard counters the workers publish after
+ * every batch.
+ *
+ * Workers spin on their queues for SHARD_SPIN empty rounds and
+ * then yield the CPU, so idle shards don't starve busy threads on
+ * machines with fewer cores than threads.
+ ****************************************************************/
+
+#ifndef SHARDEDMAP_H
+#define SHARDEDMAP_H
+
+#include <atomic>       // queue indices, stop flag and published counters
+#include <vector>
+#include <memory>       // unique_ptr ownership of shards, clients and batches
+#include <thread>       // one worker per shard
+#include <mutex>        // connect() registers clients one at a time
+#include <stdexcept>    // too many clients
+#include <utility>      // std::move
+#include <cstdio>       // load report
+#include <pthread.h>    // pinning workers to cores
+#include <sched.h>
+#include "hashmap.h"    // each shard's table and foldMultiply
+
+#define SHARD_BATCH 64          // operations a client collects per shard before sending them
+#define SHARD_QUEUE 64          // batches in flight per client and shard (ring buffer capacity, a power of two)
+#define SHARD_CLIENTS 64        // clients that can connect to one map
+#define SHARD_SPIN 256          // empty polls before a worker or waiting client yields its CPU
+
+/*************************************************
+ * SpscQueue class contents by section:
+ * 1. SpscQueue class private data members
+ * 2. SpscQueue class method prototypes
+ *
+ * Bounded ring buffer for exactly one producer
+ * and one consumer thread. Each side keeps its
+ * own index on its own cache line plus a cached
+ * copy of the other side's, so it only reads the
+ * shared index when the cache says full/empty.
+ *************************************************/
+template <class T, unsigned long Capacity>
+class SpscQueue {
+private:
+    // 1.
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+    T slots[Capacity];
+    alignas(64) std::atomic<unsigned long> head{0};         // next slot to pop, written by the consumer
+    unsigned long cachedTail = 0;                           // consumer's last look at tail
+    alignas(64) std::atomic<unsigned long> tail{0};         // next slot to push, written by the producer
+    unsigned long cachedHead = 0;                           // producer's last look at head
+
+public:
+    // 2.
+    bool push(const T& item);                               // producer only, false if full
+    bool pop(T& item);                                      // consumer only, false if empty
+};
+
+// Append item, false if the queue is full
+template <class T, unsigned long Capacity>
+bool SpscQueue<T, Capacity>::push(const T& item){
+    unsigned long t = this->tail.load(std::memory_order_relaxed);
+    if(t - this->cachedHead == Capacity){
+        this->cachedHead = this->head.load(std::memory_order_acquire);
+        if(t - this->cachedHead == Capacity){
+            return false;
+        }
+    }
+    this->slots[t & (Capacity - 1)] = item;
+    this->tail.store(t + 1, std::memory_order_release);     // publishes the slot and everything item points at
+    return true;
+}
+
+// Take the oldest item, false if the queue is empty
+template <class T, unsigned long Capacity>
+bool SpscQueue<T, Capacity>::pop(T& item){
+    unsigned long h = this->head.load(std::memory_order_relaxed);
+    if(h == this->cachedTail){
+        this->cachedTail = this->tail.load(std::memory_order_acquire);
+        if(h == this->cachedTail){
+            return false;
+        }
+    }
+    item = this->slots[h & (Capacity - 1)];
+    this->head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+// Counters a shard publishes after every batch
+struct ShardLoad {
+    unsigned long entries = 0;                              // keys in the shard's table
+    unsigned long ops = 0;                                  // operations run
+    unsigned long batches = 0;                              // batches run
+    unsigned long idle = 0;                                 // times the worker found every queue empty and yielded
+};
+
+/*******************************************************
+ * ShardedHashMap class contents by section:
+ * 1. ShardedHashMap message types
+ * 2. ShardedHashMap private types and data members
+ * 3. ShardedHashMap private helper prototypes
+ * 4. ShardedHashMap constructor/destructor prototypes
+ * 5. ShardedHashMap class method prototypes
+ *******************************************************/
+template <class Key, class Value, class Hash = std::hash<Key>, class Eq = std::equal_to<Key>, class Pool = HeapPool>
+class ShardedHashMap {
+public:
+    // 1.
+    enum OpKind { PUT, FIND };
+    struct Op {
+        OpKind kind;
+        Key key;
+        Value value;                                        // PUT: the value to store, FIND: the value found
+        unsigned long tag;                                  // the caller's, handed back untouched
+        bool found;                                         // PUT: the key was already there, FIND: it was found
+    };
+    struct Batch {
+        std::vector<Op> ops;
+    };
+    class Client;
+
+private:
+    // 2.
+    using Table = HashMap<Key, Value, Hash, Eq, Pool>;
+    using Queue = SpscQueue<Batch *, SHARD_QUEUE>;
+    struct Channel {                                        // one client's line to one shard
+        Queue requests;                                     // client to shard
+        Queue responses;                                    // shard to client
+    };
+    struct alignas(64) Shard {
+        Table table;
+        std::unique_ptr<Channel> channels[SHARD_CLIENTS];   // filled in by connect(), read by the worker
+        std::atomic<unsigned int> clients{0};               // channels the worker polls
+        std::atomic<unsigned long> entries{0};              // published ShardLoad
+        std::atomic<unsigned long> ops{0};
+        std::atomic<unsigned long> batches{0};
+        std::atomic<unsigned long> idle{0};
+        std::thread worker;
+        explicit Shard(unsigned long size) : table(size){}
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::unique_ptr<Client>> clients;
+    std::mutex connecting;
+    std::atomic<bool> stopping{false};
+    Hash hasher;
+
+    // 3.
+    void run(unsigned int s);                               // worker loop of shard s
+    void execute(Table& table, Batch& batch);               // run every op of a batch
+
+public:
+    // 4.
+    ShardedHashMap(unsigned int shards, unsigned long sizePerShard, bool pin = true);
+    ~ShardedHashMap();                                      // stops the workers; clients must be drained first
+    ShardedHashMap(const ShardedHashMap&) = delete;
+    ShardedHashMap& operator=(const ShardedHashMap&) = delete;
+
+    // 5.
+    unsigned int getShards() const;
+    template <class K>
+    unsigned int shardOf(const K& key) const;               // the shard that owns key
+    Client *connect();                                      // a new client for the calling thread (throws past SHARD_CLIENTS)
+    unsigned long getCount() const;                         // entries in every shard, as of their last batch
+    ShardLoad load(unsigned int s) const;                   // shard s's published counters
+    void printLoad(FILE *out) const;                        // one line per shard
+};
+
+/*************************************************
+ * ShardedHashMap::Client class contents by section:
+ * 1. Client class private data members
+ * 2. Client constructor prototype
+ * 3. Client class method prototypes
+ *
+ * A client belongs to one thread. Its operations
+ * complete asynchronously, in order per shard.
+ *************************************************/
+template <class Key, class Value, class Hash, class Eq, class Pool>
+class ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client {
+private:
+    // 1.
+    ShardedHashMap& map;
+    unsigned int slot;                                      // this client's channel in every shard
+    std::vector<Batch *> open;                              // batch being filled for each shard (nullptr if none)
+    std::vector<std::vector<Batch *>> spare;                // polled batches ready for reuse, per shard
+    std::vector<std::pair<unsigned int, Batch *>> ready;    // returned batches (and their shard) not yet polled
+    std::vector<std::unique_ptr<Batch>> owned;              // every batch this client ever allocated
+    std::vector<unsigned long> inFlight;                    // batches in either of each shard's queues
+    unsigned long pendingOps;                               // operations added and not yet handed to poll()
+
+    Batch *batchFor(unsigned int s);                        // the open batch for shard s, starting one if needed
+    void send(unsigned int s);                              // push shard s's open batch
+    bool receive();                                         // move returned batches to ready, false if there were none
+
+public:
+    // 2.
+    Client(ShardedHashMap& map, unsigned int slot);
+
+    // 3.
+    void put(Key key, Value value, unsigned long tag = 0);  // insert or replace
+    void find(Key key, unsigned long tag = 0);              // look up, the value comes back through poll()
+    void flush();                                           // send every partly filled batch
+    template <class F>
+    unsigned long poll(F done);                             // done(const Op&) for each completed op, returns how many
+    template <class F>
+    void drain(F done);                                     // flush, then poll until nothing is pending
+    unsigned long pending() const;                          // operations not yet completed and polled
+};
+
+// Start one worker per shard, pinned to cores 0, 1, 2, ... when pin is set
+template <class Key, class Value, class Hash, class Eq, class Pool>
+ShardedHashMap<Key, Value, Hash, Eq, Pool>::ShardedHashMap(unsigned int shards, unsigned long sizePerShard, bool pin){
+    if(shards == 0){
+        shards = 1;
+    }
+    for(unsigned int s = 0; s < shards; s++){
+        this->shards.push_back(std::unique_ptr<Shard>(new Shard(sizePerShard)));
+    }
+    unsigned int cores = std::thread::hardware_concurrency();
+    for(unsigned int s = 0; s < shards; s++){
+        this->shards[s]->worker = std::thread(&ShardedHashMap::run, this, s);
+        if(pin && cores > 0){
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(s % cores, &set);
+            pthread_setaffinity_np(this->shards[s]->worker.native_handle(), sizeof(set), &set);  // best effort
+        }
+    }
+}
+
+// Stop and join every worker
+template <class Key, class Value, class Hash, class Eq, class Pool>
+ShardedHashMap<Key, Value, Hash, Eq, Pool>::~ShardedHashMap(){
+    this->stopping.store(true, std::memory_order_release);
+    for(std::unique_ptr<Shard>& shard : this->shards){
+        shard->worker.join();
+    }
+}
+
+// Run every operation of a batch against a shard's table
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::execute(Table& table, Batch& batch){
+    for(Op& op : batch.ops){
+        Value *v = table.find(op.key);
+        op.found = v != nullptr;
+        if(op.kind == PUT){
+            if(v != nullptr){
+                *v = std::move(op.value);
+            }
+            else{
+                table.put(op.key, std::move(op.value));
+            }
+        }
+        else if(v != nullptr){
+            op.value = *v;
+        }
+    }
+}
+
+// Worker loop: poll every client's request queue, run what arrives, send it back
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::run(unsigned int s){
+    Shard& shard = *this->shards[s];
+    unsigned long ops = 0;
+    unsigned long batches = 0;
+    unsigned long idle = 0;
+    unsigned int empty = 0;
+    while(true){
+        bool stop = this->stopping.load(std::memory_order_acquire);   // read first, so nothing sent before it is missed
+        bool worked = false;
+        unsigned int n = shard.clients.load(std::memory_order_acquire);
+        for(unsigned int c = 0; c < n; c++){
+            Channel& channel = *shard.channels[c];
+            Batch *batch;
+            while(channel.requests.pop(batch)){
+                this->execute(shard.table, *batch);
+                ops += batch->ops.size();
+                batches++;
+                while(!channel.responses.push(batch)){}     // can't fill: a client has at most SHARD_QUEUE in flight
+                worked = true;
+            }
+        }
+        if(worked){
+            empty = 0;
+            shard.entries.store(shard.table.getCount(), std::memory_order_relaxed);
+            shard.ops.store(ops, std::memory_order_relaxed);
+            shard.batches.store(batches, std::memory_order_relaxed);
+        }
+        else if(stop){
+            return;
+        }
+        else if(++empty >= SHARD_SPIN){
+            empty = 0;
+            shard.idle.store(++idle, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Number of shards
+template <class Key, class Value, class Hash, class Eq, class Pool>
+unsigned int ShardedHashMap<Key, Value, Hash, Eq, Pool>::getShards() const{
+    return this->shards.size();
+}
+
+// The shard that owns key (the hash is remixed so it doesn't follow the shard's own bucket choice)
+template <class Key, class Value, class Hash, class Eq, class Pool>
+template <class K>
+unsigned int ShardedHashMap<Key, Value, Hash, Eq, Pool>::shardOf(const K& key) const{
+    return static_cast<unsigned int>(FastRange::bucket(foldMultiply(this->hasher(key), 0x9E3779B97F4A7C15ULL),
+                                                       this->shards.size()));
+}
+
+// Register a client with every shard
+template <class Key, class Value, class Hash, class Eq, class Pool>
+typename ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client *ShardedHashMap<Key, Value, Hash, Eq, Pool>::connect(){
+    std::lock_guard<std::mutex> lock(this->connecting);
+    unsigned int slot = this->clients.size();
+    if(slot == SHARD_CLIENTS){
+        throw std::runtime_error("ShardedHashMap: more than SHARD_CLIENTS clients");
+    }
+    for(std::unique_ptr<Shard>& shard : this->shards){
+        shard->channels[slot].reset(new Channel);
+        shard->clients.store(slot + 1, std::memory_order_release);  // the worker only looks at the channel after this
+    }
+    this->clients.push_back(std::unique_ptr<Client>(new Client(*this, slot)));
+    return this->clients.back().get();
+}
+
+// Entries in every shard as of its last batch
+template <class Key, class Value, class Hash, class Eq, class Pool>
+unsigned long ShardedHashMap<Key, Value, Hash, Eq, Pool>::getCount() const{
+    unsigned long total = 0;
+    for(const std::unique_ptr<Shard>& shard : this->shards){
+        total += shard->entries.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// Shard s's published counters
+template <class Key, class Value, class Hash, class Eq, class Pool>
+ShardLoad ShardedHashMap<Key, Value, Hash, Eq, Pool>::load(unsigned int s) const{
+    const Shard& shard = *this->shards[s];
+    ShardLoad l;
+    l.entries = shard.entries.load(std::memory_order_relaxed);
+    l.ops = shard.ops.load(std::memory_order_relaxed);
+    l.batches = shard.batches.load(std::memory_order_relaxed);
+    l.idle = shard.idle.load(std::memory_order_relaxed);
+    return l;
+}
+
+// One line per shard: entries, ops, ops per batch and idle yields
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::printLoad(FILE *out) const{
+    unsigned long ops = 0;
+    for(unsigned int s = 0; s < this->getShards(); s++){
+        ops += this->load(s).ops;
+    }
+    for(unsigned int s = 0; s < this->getShards(); s++){
+        ShardLoad l = this->load(s);
+        fprintf(out, "shard %2u | %9lu entries | %10lu ops (%5.1f%%) | %6.1f ops/batch | %lu idle yields\n", s,
+                l.entries, l.ops, ops > 0 ? 100.0 * l.ops / ops : 0, l.batches > 0 ? static_cast<double>(l.ops) / l.batches : 0,
+                l.idle);
+    }
+}
+
+// Client with its own channel in every shard
+template <class Key, class Value, class Hash, class Eq, class Pool>
+ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::Client(ShardedHashMap& map, unsigned int slot)
+    : map(map), open(map.getShards(), nullptr), spare(map.getShards()), inFlight(map.getShards(), 0){
+    this->slot = slot;
+    this->pendingOps = 0;
+}
+
+// The batch being filled for shard s, reusing a returned one when there is one
+template <class Key, class Value, class Hash, class Eq, class Pool>
+typename ShardedHashMap<Key, Value, Hash, Eq, Pool>::Batch *
+ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::batchFor(unsigned int s){
+    if(this->open[s] != nullptr){
+        return this->open[s];
+    }
+    Batch *batch;
+    if(!this->spare[s].empty()){
+        batch = this->spare[s].back();
+        this->spare[s].pop_back();
+    }
+    else{
+        this->owned.push_back(std::unique_ptr<Batch>(new Batch));
+        batch = this->owned.back().get();
+        batch->ops.reserve(SHARD_BATCH);
+    }
+    batch->ops.clear();
+    this->open[s] = batch;
+    return batch;
+}
+
+// Send shard s's open batch
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::send(unsigned int s){
+    for(unsigned int empty = 0; this->inFlight[s] == SHARD_QUEUE;){ // both queues are full, wait for a batch back
+        if(!this->receive() && ++empty >= SHARD_SPIN){
+            empty = 0;
+            std::this_thread::yield();
+        }
+    }
+    Channel& channel = *this->map.shards[s]->channels[this->slot];
+    channel.requests.push(this->open[s]);                   // can't fail, the queues hold fewer than SHARD_QUEUE
+    this->inFlight[s]++;
+    this->open[s] = nullptr;
+}
+
+// Insert or replace key
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::put(Key key, Value value, unsigned long tag){
+    unsigned int s = this->map.shardOf(key);
+    Batch *batch = this->batchFor(s);
+    batch->ops.push_back(Op{PUT, std::move(key), std::move(value), tag, false});
+    this->pendingOps++;
+    if(batch->ops.size() == SHARD_BATCH){
+        this->send(s);
+    }
+}
+
+// Look up key, the result comes back through poll()
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::find(Key key, unsigned long tag){
+    unsigned int s = this->map.shardOf(key);
+    Batch *batch = this->batchFor(s);
+    batch->ops.push_back(Op{FIND, std::move(key), Value(), tag, false});
+    this->pendingOps++;
+    if(batch->ops.size() == SHARD_BATCH){
+        this->send(s);
+    }
+}
+
+// Send every partly filled batch
+template <class Key, class Value, class Hash, class Eq, class Pool>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::flush(){
+    for(unsigned int s = 0; s < this->open.size(); s++){
+        if(this->open[s] != nullptr){
+            this->send(s);
+        }
+    }
+}
+
+// Move every batch the shards have sent back onto the ready list
+template <class Key, class Value, class Hash, class Eq, class Pool>
+bool ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::receive(){
+    bool any = false;
+    for(unsigned int s = 0; s < this->open.size(); s++){
+        Channel& channel = *this->map.shards[s]->channels[this->slot];
+        Batch *batch;
+        while(channel.responses.pop(batch)){
+            this->ready.emplace_back(s, batch);
+            this->inFlight[s]--;
+            any = true;
+        }
+    }
+    return any;
+}
+
+// Hand every completed operation to done(const Op&), returns how many there were
+template <class Key, class Value, class Hash, class Eq, class Pool>
+template <class F>
+unsigned long ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::poll(F done){
+    this->receive();
+    unsigned long completed = 0;
+    for(std::pair<unsigned int, Batch *>& r : this->ready){
+        for(const Op& op : r.second->ops){
+            done(op);
+        }
+        completed += r.second->ops.size();
+        this->spare[r.first].push_back(r.second);
+    }
+    this->ready.clear();
+    this->pendingOps -= completed;
+    return completed;
+}
+
+// Send everything and wait until every operation has come back through done
+template <class Key, class Value, class Hash, class Eq, class Pool>
+template <class F>
+void ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::drain(F done){
+    this->flush();
+    for(unsigned int empty = 0; this->pendingOps > 0;){
+        if(this->poll(done) == 0 && ++empty >= SHARD_SPIN){
+            empty = 0;
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Operations added and not yet handed to poll() or drain()
+template <class Key, class Value, class Hash, class Eq, class Pool>
+unsigned long ShardedHashMap<Key, Value, Hash, Eq, Pool>::Client::pending() const{
+    return this->pendingOps;
+}
+
+#endif //SHARDEDMAP_H
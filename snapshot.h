@@ -0,0 +1,454 @@
+/****************************************************************
+ * Memory mapped student snapshots.
+ *
+ * A snapshot file holds a whole table in a form that can be used
+ * straight from the page cache, with no pointers in it:
+ *
+ *   SnapshotHeader   magic, version, record/bucket counts and the
+ *                    file offset of each section below
+ *   bucket offsets   buckets + 1 uint64 indexes into the records;
+ *                    bucket b holds records [offset[b], offset[b+1])
+ *   records          SnapshotRecord, 40 bytes each, grouped by bucket
+ *   names            every distinct name once, back to back
+ *
+ * A record finds its name through an offset relative to the record
+ * itself, so the file can be mapped at any address. The bucket of an
+ * ID is NumericIDHash(id) & (buckets - 1), which is fixed by the
+ * format version, so a lookup is one read of two adjacent offsets
+ * and a scan of a few contiguous records.
+ *
+ * StudentSnapshot maps a file read-only and serves lookups from the
+ * mapped pages. Puts go to an in-memory copy-on-write overlay that
+ * shadows the mapped records; snapshot() writes the merged table to
+ * a new file, renames it into place and maps that instead, so
+ * opening even a very large table costs the mmap call and a check of
+ * the header: no record is read until a lookup needs it. A lookup
+ * checks the two offsets of its bucket and the name of the record it
+ * returns against the file, so a damaged file can't send it outside
+ * the mapping; verify() checks every offset and record up front.
+ *
+ * An overlay record keeps its name in the same overlay node, so
+ * replacing a student reuses the name's buffer when the new name
+ * fits and the overlay never holds more names than records.
+ ****************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>      // memcmp/memcpy on fixed width IDs
+#include <cstdio>       // rename
+#include <memory>       // the overlay is replaced after each snapshot
+#include <string>
+#include <string_view>
+#include <vector>       // per-bucket write cursors
+#include <fcntl.h>      // open
+#include <unistd.h>     // close, ftruncate
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+#include "student.h"    // Student records
+#include "hashmap.h"    // the overlay and NumericIDHash/MaskRange
+#include "flathashmap.h"    // name deduplication while writing
+
+#define SNAPSHOT_MAGIC "STUSNAP"    // 7 characters and a terminating zero
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ID_BYTES 16        // IDs up to 16 characters are stored inline, zero padded
+
+// First bytes of a snapshot file
+struct SnapshotHeader {
+    char magic[8];                                          // SNAPSHOT_MAGIC
+    uint32_t version;                                       // SNAPSHOT_VERSION
+    uint32_t recordBytes;                                   // sizeof(SnapshotRecord) when written
+    uint64_t count;                                         // number of records
+    uint64_t buckets;                                       // number of buckets (a power of two)
+    uint64_t offsetsAt;                                     // file offset of the bucket offsets
+    uint64_t recordsAt;                                     // file offset of the records
+    uint64_t namesAt;                                       // file offset of the names
+    uint64_t fileBytes;                                     // total file size
+};
+
+// One student as stored in a snapshot (and in the overlay)
+struct SnapshotRecord {
+    char id[SNAPSHOT_ID_BYTES];                             // the ID, zero padded
+    int64_t nameOffset;                                     // from this record's address to its name
+    uint32_t nameLength;
+    uint32_t age;
+    double gpa;
+
+    std::string_view getID() const{ return std::string_view(this->id, strnlen(this->id, SNAPSHOT_ID_BYTES)); }
+    std::string_view getName() const{
+        return std::string_view(reinterpret_cast<const char *>(this) + this->nameOffset, this->nameLength);
+    }
+    unsigned int getAge() const{ return this->age; }
+    double getGPA() const{ return this->gpa; }
+};
+
+/****************************************************
+ * StudentSnapshot class contents by section:
+ * 1. StudentSnapshot class private data members
+ * 2. StudentSnapshot private helper prototypes
+ * 3. StudentSnapshot constructor/destructor prototypes
+ * 4. StudentSnapshot class method prototypes
+ ****************************************************/
+class StudentSnapshot {
+private:
+    // 1.
+    struct OverlayEntry {                                   // an overlay record and the name it points at
+        SnapshotRecord record;
+        string name;
+    };
+    using Overlay = HashMap<string, OverlayEntry, NumericIDHash, StringEq, SlabPool>;
+    const char *base;                                       // the mapped file (nullptr when nothing is mapped)
+    unsigned long bytes;                                    // length of the mapping
+    const SnapshotHeader *header;
+    const uint64_t *offsets;                                // buckets + 1 record indexes
+    const SnapshotRecord *records;
+    std::unique_ptr<Overlay> overlay;                       // puts since the file was mapped
+    unsigned long shadowed;                                 // mapped records replaced by an overlay record
+
+    // 2.
+    const SnapshotRecord *findMapped(std::string_view id) const;    // lookup in the mapped file only
+    static bool validate(const char *base, unsigned long size);     // the header's sections lie inside the file
+    bool nameInside(uint64_t i) const;                      // record i's name lies inside the names section
+    void unmap();
+
+public:
+    // 3.
+    StudentSnapshot();
+    ~StudentSnapshot();
+    StudentSnapshot(const StudentSnapshot&) = delete;
+    StudentSnapshot& operator=(const StudentSnapshot&) = delete;
+
+    // 4.
+    bool open(const string& path);                          // map a snapshot file, false if its header isn't a valid one
+    bool verify() const;                                    // check every bucket offset and record name of the mapped file
+    bool snapshot(const string& path);                      // write everything to path and map it, emptying the overlay
+    bool put(const Student& s);                             // insert or replace, false if the ID is too long
+    const SnapshotRecord *find(std::string_view id) const;  // the record for id or nullptr
+    unsigned long getCount() const;                         // number of students
+    unsigned long getMappedCount() const;                   // students served from the mapped file
+    unsigned long getOverlayCount() const;                  // students in the overlay
+    unsigned long getFileBytes() const;                     // size of the mapped file
+    template <class F>
+    void forEach(F visit) const;                            // call visit(id, record) for every student
+    template <class F>
+    void forEachNewest(F visit) const;                      // the same, forEach() never visits a replaced record
+    template <class Table>
+    static bool write(const string& path, const Table& table);  // write any table of Students or SnapshotRecords
+};
+
+// StudentSnapshot constructor, nothing mapped and an empty overlay
+inline StudentSnapshot::StudentSnapshot() : overlay(new Overlay(97)){
+    this->base = nullptr;
+    this->bytes = 0;
+    this->header = nullptr;
+    this->offsets = nullptr;
+    this->records = nullptr;
+    this->shadowed = 0;
+}
+
+// StudentSnapshot destructor
+inline StudentSnapshot::~StudentSnapshot(){
+    this->unmap();
+}
+
+// Release the current mapping
+inline void StudentSnapshot::unmap(){
+    if(this->base != nullptr){
+        munmap(const_cast<char *>(this->base), this->bytes);
+    }
+    this->base = nullptr;
+    this->bytes = 0;
+    this->header = nullptr;
+    this->offsets = nullptr;
+    this->records = nullptr;
+}
+
+// Map a snapshot file in place of whatever was mapped before (the overlay is kept)
+inline bool StudentSnapshot::open(const string& path){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || static_cast<unsigned long>(st.st_size) < sizeof(SnapshotHeader)){
+        close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                                              // the mapping keeps the file alive
+    if(map == MAP_FAILED){
+        return false;
+    }
+    auto h = static_cast<const SnapshotHeader *>(map);
+    unsigned long size = st.st_size;
+    if(!validate(static_cast<const char *>(map), size)){
+        munmap(map, size);
+        return false;
+    }
+    madvise(map, size, MADV_RANDOM);                        // lookups jump around, don't read ahead
+    this->unmap();
+    this->base = static_cast<const char *>(map);
+    this->bytes = size;
+    this->header = h;
+    this->offsets = reinterpret_cast<const uint64_t *>(this->base + h->offsetsAt);
+    this->records = reinterpret_cast<const SnapshotRecord *>(this->base + h->recordsAt);
+    this->shadowed = 0;
+    this->overlay->forEach([this](const string& id, const OverlayEntry&){
+        this->shadowed += this->findMapped(id) != nullptr;
+    });
+    return true;
+}
+
+/*
+ * Check a mapped file's header before anything trusts it: the
+ * sections must be in order and inside the file (compared by
+ * division, so huge counts can't overflow) and the bucket offsets
+ * must start at 0 and end at count. Nothing past the header and
+ * those two offsets is read, findMapped() checks the rest as it goes.
+ */
+inline bool StudentSnapshot::validate(const char *base, unsigned long size){
+    auto h = reinterpret_cast<const SnapshotHeader *>(base);
+    if(memcmp(h->magic, SNAPSHOT_MAGIC, 8) != 0 || h->version != SNAPSHOT_VERSION ||
+       h->recordBytes != sizeof(SnapshotRecord) || h->fileBytes != size ||
+       h->buckets == 0 || (h->buckets & (h->buckets - 1)) != 0 ||
+       h->offsetsAt % alignof(uint64_t) != 0 || h->recordsAt % alignof(SnapshotRecord) != 0 ||
+       h->offsetsAt < sizeof(SnapshotHeader) || h->offsetsAt > h->recordsAt ||
+       h->recordsAt > h->namesAt || h->namesAt > size ||
+       h->buckets >= (h->recordsAt - h->offsetsAt) / sizeof(uint64_t) ||     // room for buckets + 1 offsets
+       h->count > (h->namesAt - h->recordsAt) / sizeof(SnapshotRecord)){
+        return false;
+    }
+    auto offsets = reinterpret_cast<const uint64_t *>(base + h->offsetsAt);
+    return offsets[0] == 0 && offsets[h->buckets] == h->count;
+}
+
+// Whether mapped record i points at a name inside the names section
+inline bool StudentSnapshot::nameInside(uint64_t i) const{
+    int64_t at = this->header->recordsAt + i * sizeof(SnapshotRecord); // where the record is, nameOffset counts from here
+    int64_t first = this->records[i].nameOffset;
+    int64_t size = this->bytes;
+    return first >= static_cast<int64_t>(this->header->namesAt) - at && first <= size - at &&
+           this->records[i].nameLength <= size - at - first;
+}
+
+// Read the whole mapped file: the bucket offsets must never go backwards and every record's name must be inside it
+inline bool StudentSnapshot::verify() const{
+    if(this->header == nullptr){
+        return true;
+    }
+    for(uint64_t b = 0; b < this->header->buckets; b++){
+        if(this->offsets[b] > this->offsets[b + 1]){
+            return false;
+        }
+    }
+    for(uint64_t i = 0; i < this->header->count; i++){
+        if(!this->nameInside(i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find id among the mapped records, a bucket or record that points outside the file counts as missing
+inline const SnapshotRecord *StudentSnapshot::findMapped(std::string_view id) const{
+    if(this->header == nullptr || id.length() > SNAPSHOT_ID_BYTES){
+        return nullptr;
+    }
+    char key[SNAPSHOT_ID_BYTES] = {};                       // padded the same way as the stored IDs
+    memcpy(key, id.data(), id.length());
+    uint64_t b = NumericIDHash()(id) & (this->header->buckets - 1);
+    uint64_t end = this->offsets[b + 1];
+    if(end > this->header->count){                          // the header checked only the first and last offset
+        return nullptr;
+    }
+    for(uint64_t i = this->offsets[b]; i < end; i++){
+        if(memcmp(this->records[i].id, key, SNAPSHOT_ID_BYTES) == 0){
+            return this->nameInside(i) ? &this->records[i] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// Look in the overlay first (it holds the newest writes), then in the mapped file
+inline const SnapshotRecord *StudentSnapshot::find(std::string_view id) const{
+    const OverlayEntry *e = this->overlay->find(id);
+    return e != nullptr ? &e->record : this->findMapped(id);
+}
+
+// Insert or replace a student in the overlay, the mapped file is never written to
+inline bool StudentSnapshot::put(const Student& s){
+    if(s.getID().length() > SNAPSHOT_ID_BYTES){
+        return false;
+    }
+    OverlayEntry *e = this->overlay->find(s.getID());
+    if(e == nullptr){
+        this->shadowed += this->findMapped(s.getID()) != nullptr;
+        e = &this->overlay->put(s.getID(), OverlayEntry{});     // nodes never move, so e stays valid
+    }
+    SnapshotRecord& r = e->record;
+    e->name = s.getName();                                  // reuses the old name's buffer when the new one fits
+    memset(r.id, 0, SNAPSHOT_ID_BYTES);
+    memcpy(r.id, s.getID().data(), s.getID().length());
+    r.nameOffset = e->name.data() - reinterpret_cast<const char *>(&r);
+    r.nameLength = e->name.length();
+    r.age = s.getAge();
+    r.gpa = s.getGPA();
+    return true;
+}
+
+// Number of students, counting each replaced one once
+inline unsigned long StudentSnapshot::getCount() const{
+    return this->getMappedCount() - this->shadowed + this->overlay->getCount();
+}
+
+// Students in the mapped file
+inline unsigned long StudentSnapshot::getMappedCount() const{
+    return this->header != nullptr ? this->header->count : 0;
+}
+
+// Students written since the file was mapped
+inline unsigned long StudentSnapshot::getOverlayCount() const{
+    return this->overlay->getCount();
+}
+
+// Size of the mapped file (0 when nothing is mapped)
+inline unsigned long StudentSnapshot::getFileBytes() const{
+    return this->bytes;
+}
+
+// Visit every student as (ID, record): the overlay, then every mapped record it doesn't shadow (skipping any record
+// whose name points outside the file)
+template <class F>
+void StudentSnapshot::forEach(F visit) const{
+    this->overlay->forEach([&visit](const string& id, const OverlayEntry& e){
+        visit(std::string_view(id), e.record);
+    });
+    for(uint64_t i = 0; i < this->getMappedCount(); i++){
+        std::string_view id = this->records[i].getID();
+        if(this->nameInside(i) && (this->shadowed == 0 || this->overlay->find(id) == nullptr)){
+            visit(id, this->records[i]);
+        }
+    }
+}
+
+// Every student once, as write() expects of any table
+template <class F>
+void StudentSnapshot::forEachNewest(F visit) const{
+    this->forEach(visit);
+}
+
+// Write the merged table to a temporary file, rename it over path and map it in place of the old one
+inline bool StudentSnapshot::snapshot(const string& path){
+    if(!write(path, *this)){
+        return false;
+    }
+    StudentSnapshot fresh;                                  // map before touching this one, so a failure loses nothing
+    if(!fresh.open(path)){
+        return false;
+    }
+    std::swap(this->base, fresh.base);                      // fresh unmaps the old file as it goes out of scope
+    std::swap(this->bytes, fresh.bytes);
+    std::swap(this->header, fresh.header);
+    std::swap(this->offsets, fresh.offsets);
+    std::swap(this->records, fresh.records);
+    this->overlay.reset(new Overlay(97));                   // everything it held is in the file now
+    this->shadowed = 0;
+    return true;
+}
+
+/*
+ * Write any table with getCount() and a forEachNewest that visits
+ * (id, value) once per ID, value being what find() returns for it
+ * (Student or SnapshotRecord, anything with getName/getAge/getGPA),
+ * so an ID put twice into a HashMap is saved as its newest record.
+ * The file is sized up front, mapped and filled in place, then
+ * renamed over path so a reader never sees a half written snapshot.
+ * The table is walked twice: once to size the buckets and lay out
+ * the names, once to place every record.
+ */
+template <class Table>
+bool StudentSnapshot::write(const string& path, const Table& table){
+    NumericIDHash hash;
+    uint64_t buckets = MaskRange::fit(table.getCount() > 0 ? table.getCount() : 1);
+    std::vector<uint64_t> start(buckets + 1, 0);            // bucket sizes, then where each bucket starts
+
+    // pass 1: count the records of every bucket and lay out every distinct name once
+    FlatHashMap<std::string_view, uint64_t, WyHash, StringEq> nameAt(1024);
+    uint64_t count = 0;
+    uint64_t nameBytes = 0;
+    bool fits = true;
+    table.forEachNewest([&](std::string_view id, const auto& s){
+        count++;
+        fits = fits && id.length() <= SNAPSHOT_ID_BYTES;
+        start[(hash(id) & (buckets - 1)) + 1]++;
+        std::string_view name = s.getName();
+        if(nameAt.find(name) == nullptr){
+            nameAt.put(name, nameBytes);                    // views the table's own copy, which outlives this call
+            nameBytes += name.length();
+        }
+    });
+    if(!fits){
+        return false;
+    }
+    for(uint64_t b = 0; b < buckets; b++){
+        start[b + 1] += start[b];
+    }
+
+    SnapshotHeader h{};
+    memcpy(h.magic, SNAPSHOT_MAGIC, 8);
+    h.version = SNAPSHOT_VERSION;
+    h.recordBytes = sizeof(SnapshotRecord);
+    h.count = count;
+    h.buckets = buckets;
+    h.offsetsAt = sizeof(SnapshotHeader);
+    h.recordsAt = h.offsetsAt + (buckets + 1) * sizeof(uint64_t);
+    h.namesAt = h.recordsAt + count * sizeof(SnapshotRecord);
+    h.fileBytes = h.namesAt + nameBytes;
+
+    string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        return false;
+    }
+    if(ftruncate(fd, h.fileBytes) != 0){
+        close(fd);
+        unlink(temp.c_str());
+        return false;
+    }
+    void *map = mmap(nullptr, h.fileBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        unlink(temp.c_str());
+        return false;
+    }
+    char *out = static_cast<char *>(map);
+    memcpy(out, &h, sizeof(h));
+    memcpy(out + h.offsetsAt, start.data(), (buckets + 1) * sizeof(uint64_t));
+    auto records = reinterpret_cast<SnapshotRecord *>(out + h.recordsAt);
+    char *names = out + h.namesAt;
+    nameAt.forEach([names](std::string_view name, uint64_t at){
+        memcpy(names + at, name.data(), name.length());
+    });
+
+    // pass 2: place every record at the next free position of its bucket
+    table.forEachNewest([&](std::string_view id, const auto& s){
+        SnapshotRecord& r = records[start[hash(id) & (buckets - 1)]++];
+        std::string_view name = s.getName();
+        memset(&r, 0, sizeof(r));
+        memcpy(r.id, id.data(), id.length());
+        r.nameOffset = (names + *nameAt.find(name)) - reinterpret_cast<char *>(&r);
+        r.nameLength = name.length();
+        r.age = s.getAge();
+        r.gpa = s.getGPA();
+    });
+    bool ok = msync(map, h.fileBytes, MS_SYNC) == 0;        // on disk before it replaces the old file
+    munmap(map, h.fileBytes);
+    if(!ok || rename(temp.c_str(), path.c_str()) != 0){
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,125 @@
+/****************************************************************
+ * Student records.
+ *
+ * A Student is a plain record (name, 10-digit ID, age and GPA).
+ * The hash tables themselves are generic; the aliases at the end
+ * of this file are the Student instantiations of the chained engine
+ * every module shares, keyed by the student's ID. The other engines
+ * are included, and instantiated for Student, only by the programs
+ * that use them.
+ ****************************************************************/
+
+#ifndef STUDENT_H
+#define STUDENT_H
+
+#include <iostream>     // input/output
+#include <iomanip>      // allows for gpa precision manipulation
+#include <string>       // string manipulation
+#include "hashmap.h"    // generic separate chaining engine
+
+using std::string;      // global use of std::string due to illegality of class usage of "using"
+                        // std::string is also widely used throughout the entire program
+
+/**********************************************************
+ * Student class contents by section:
+ * 1. Student class private data members
+ * 2. Student constructor prototypes
+ * 3. Student class method prototypes: getters and setters
+ **********************************************************/
+class Student{
+private:
+    // 1.
+    string name;                                            // student's name
+    string id;                                              // student's id
+    unsigned int age;                                       // student's age
+    double gpa;                                             // student's gpa
+    
+public:
+    // 2.
+    Student(string name, string id, int age, double gpa);   // Overloaded student constructor
+    Student();                                              // Null student constructor
+    
+    // 3.
+    const string& getName() const;                          // get student's name
+    void setName(string n);                                 // set student's name
+    const string& getID() const;                            // get student's ID
+    void setID(string i);                                   // set student's ID
+    unsigned int getAge() const;                            // get student's age
+    void setAge(unsigned int a);                            // set student's age
+    double getGPA() const;                                  // get student's GPA
+    void setGPA(double g);                                  // set student's GPA
+    void display() const;                                   // display student information
+};
+
+// Null Student constructor
+inline Student::Student(){
+    this->name = "null";            // set this student's name to null
+    this->id = "null";              // set this student's id to null
+    this->age = 0;                  // set this student's age to 0
+    this->gpa = 0.0;                // set this student's gpa to 0.0
+}
+
+// Overloaded Student constructor
+inline Student::Student(string name, string id, int age, double gpa){
+    this->name = move(name);        // set this student's name to name
+    this->id = move(id);            // set this student's id to id
+    this->age = age;                // set this student's age to age
+    this->gpa = gpa;                // set this student's gpa to gpa
+}
+
+// Student name getter (by reference, so reading it never copies)
+inline const string& Student::getName() const{
+    return this->name;
+}
+
+inline void Student::setName(string n){
+    this->name = std::move(n);
+}
+
+// Student ID getter (by reference, so comparing it never copies)
+inline const string& Student::getID() const{
+    return this->id;
+}
+
+//
+inline void Student::setID(string i){
+    this->id = std::move(i);
+}
+
+// Student age getter
+inline unsigned int Student::getAge() const{
+    return this->age;
+}
+
+inline void Student::setAge(unsigned int a){
+    this->age = a;
+}
+
+// Student GPA getter
+inline double Student::getGPA() const{
+    return this->gpa;
+}
+
+inline void Student::setGPA(double g){
+    this->gpa = g;
+}
+
+inline void Student::display() const{
+    using std::cout;
+    using std::setprecision;
+    using std::fixed;
+    cout << "Name: ";
+    cout.width(20);
+    cout << this->name << " | ID: " << this->id << " | Age: " << this->age
+         << " | GPA: " << setprecision(2) << fixed << this->gpa << "\n";
+}
+
+/*
+ * Students are one instantiation of the generic engines, keyed by
+ * their 10-digit ID. StringHash/StringEq let them be searched with a
+ * std::string_view or const char * without building a temporary.
+ */
+using StudentMap = HashMap<string, Student, StringHash, StringEq>;
+using SlabStudentMap = HashMap<string, Student, StringHash, StringEq, SlabPool>;
+
+#endif //STUDENT_H
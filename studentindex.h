@@ -0,0 +1,443 @@
+/****************************************************************
+ * Secondary indexes on Student age and GPA.
+ *
+ * SortedIndex keeps (key, reference) entries in order in a list of
+ * small sorted blocks, a two level B+-tree: a contiguous array of
+ * each block's last entry is binary searched to find the block,
+ * and the block itself is binary searched for the entry. Blocks
+ * split when they pass INDEX_BLOCK_MAX entries and are dropped
+ * when they empty, so inserts move at most one block's worth of
+ * entries. A range scan costs O(log n) to find its first entry and
+ * then walks blocks front to back, O(log n + k) in all.
+ *
+ * IndexedStudentMap owns a chained HashMap of Students and keeps
+ * an age index and a GPA index (either can be turned off) pointing
+ * at the records inside the table's nodes. HashMap never moves a
+ * node once it is allocated, growth only relinks it, so the
+ * pointers stay valid. Every put() and update() goes through the
+ * map, which is what keeps the indexes consistent; a put() with an
+ * ID that is already present replaces that record instead of
+ * shadowing it. Bulk loads write straight to the table through
+ * bulkLoad() and rebuild the indexes once at the end with a sort.
+ * With an index turned off, its queries fall back to walking the
+ * whole table.
+ ****************************************************************/
+
+#ifndef STUDENTINDEX_H
+#define STUDENTINDEX_H
+
+#include <vector>
+#include <string_view>
+#include <algorithm>    // sort, lower_bound, partial_sort
+#include <functional>   // std::less for ordering references
+#include "student.h"    // Student records and HashMap
+
+#define INDEX_BLOCK_MAX 512     // entries a block holds before it splits in two
+#define INDEX_BLOCK_FILL 384    // entries per block when an index is built in one go
+
+/*************************************************
+ * SortedIndex class contents by section:
+ * 1. SortedIndex entry type
+ * 2. SortedIndex class private data members
+ * 3. SortedIndex private helper prototypes
+ * 4. SortedIndex class method prototypes
+ *************************************************/
+template <class Key, class Ref>
+class SortedIndex {
+public:
+    // 1.
+    struct Entry {
+        Key key;
+        Ref ref;                                            // breaks ties, so every entry is unique
+        bool operator<(const Entry& o) const{
+            return this->key < o.key || (!(o.key < this->key) && std::less<Ref>()(this->ref, o.ref));
+        }
+    };
+
+private:
+    // 2.
+    std::vector<std::vector<Entry>> blocks;                 // sorted blocks, every entry of a block before the next one's
+    std::vector<Entry> lasts;                               // last entry of each block, searched to find a block
+    unsigned long count;
+
+    // 3.
+    unsigned long blockOf(const Entry& e) const;            // the block e is in or would go in
+    unsigned long firstBlock(const Key& lo) const;          // the first block that can hold a key >= lo
+
+public:
+    // 4.
+    SortedIndex();
+    unsigned long getCount() const;
+    unsigned long memoryUsage() const;                      // bytes held by the blocks and the fence array
+    void clear();
+    void insert(const Key& key, Ref ref);
+    bool erase(const Key& key, Ref ref);                    // false if the entry wasn't there
+    void build(std::vector<Entry>& entries);                // replace the contents, sorting entries in place
+    template <class F>
+    void range(const Key& lo, const Key& hi, F visit) const;    // visit(key, ref) for lo <= key <= hi, ascending
+    template <class F>
+    void top(unsigned long k, F visit) const;               // visit(key, ref) for the k largest keys, descending
+};
+
+// Empty index
+template <class Key, class Ref>
+SortedIndex<Key, Ref>::SortedIndex(){
+    this->count = 0;
+}
+
+// Entries in the index
+template <class Key, class Ref>
+unsigned long SortedIndex<Key, Ref>::getCount() const{
+    return this->count;
+}
+
+// Bytes held by the blocks and the fence array
+template <class Key, class Ref>
+unsigned long SortedIndex<Key, Ref>::memoryUsage() const{
+    unsigned long bytes = this->blocks.capacity() * sizeof(std::vector<Entry>) + this->lasts.capacity() * sizeof(Entry);
+    for(const std::vector<Entry>& b : this->blocks){
+        bytes += b.capacity() * sizeof(Entry);
+    }
+    return bytes;
+}
+
+// Drop every entry
+template <class Key, class Ref>
+void SortedIndex<Key, Ref>::clear(){
+    this->blocks.clear();
+    this->lasts.clear();
+    this->count = 0;
+}
+
+// The first block whose last entry isn't before e (the last block if e is past them all)
+template <class Key, class Ref>
+unsigned long SortedIndex<Key, Ref>::blockOf(const Entry& e) const{
+    unsigned long b = std::lower_bound(this->lasts.begin(), this->lasts.end(), e) - this->lasts.begin();
+    return b < this->blocks.size() ? b : this->blocks.size() - 1;
+}
+
+// The first block whose last key is >= lo (blocks.size() if there is none)
+template <class Key, class Ref>
+unsigned long SortedIndex<Key, Ref>::firstBlock(const Key& lo) const{
+    return std::lower_bound(this->lasts.begin(), this->lasts.end(), lo,
+                            [](const Entry& e, const Key& k){ return e.key < k; }) - this->lasts.begin();
+}
+
+// Add an entry, splitting its block if it gets too large
+template <class Key, class Ref>
+void SortedIndex<Key, Ref>::insert(const Key& key, Ref ref){
+    Entry e{key, ref};
+    if(this->blocks.empty()){
+        this->blocks.emplace_back(1, e);
+        this->lasts.push_back(e);
+        this->count = 1;
+        return;
+    }
+    unsigned long b = this->blockOf(e);
+    std::vector<Entry>& block = this->blocks[b];
+    block.insert(std::lower_bound(block.begin(), block.end(), e), e);
+    this->count++;
+    if(block.size() > INDEX_BLOCK_MAX){                     // split, the upper half becomes block b + 1
+        std::vector<Entry> upper(block.begin() + block.size() / 2, block.end());
+        block.resize(block.size() / 2);
+        this->lasts.insert(this->lasts.begin() + b, block.back());
+        this->blocks.insert(this->blocks.begin() + b + 1, std::move(upper));   // invalidates block
+        this->lasts[b + 1] = this->blocks[b + 1].back();    // e may have been appended past the old fence
+    }
+    else{
+        this->lasts[b] = block.back();
+    }
+}
+
+// Remove an entry, dropping its block if it empties
+template <class Key, class Ref>
+bool SortedIndex<Key, Ref>::erase(const Key& key, Ref ref){
+    if(this->blocks.empty()){
+        return false;
+    }
+    Entry e{key, ref};
+    unsigned long b = this->blockOf(e);
+    std::vector<Entry>& block = this->blocks[b];
+    auto it = std::lower_bound(block.begin(), block.end(), e);
+    if(it == block.end() || e < *it){
+        return false;
+    }
+    block.erase(it);
+    this->count--;
+    if(block.empty()){
+        this->blocks.erase(this->blocks.begin() + b);
+        this->lasts.erase(this->lasts.begin() + b);
+    }
+    else{
+        this->lasts[b] = block.back();
+    }
+    return true;
+}
+
+// Replace the contents with entries, sorted once and cut into blocks with room to grow
+template <class Key, class Ref>
+void SortedIndex<Key, Ref>::build(std::vector<Entry>& entries){
+    this->clear();
+    std::sort(entries.begin(), entries.end());
+    for(unsigned long i = 0; i < entries.size(); i += INDEX_BLOCK_FILL){
+        unsigned long end = std::min<unsigned long>(i + INDEX_BLOCK_FILL, entries.size());
+        this->blocks.emplace_back(entries.begin() + i, entries.begin() + end);
+        this->lasts.push_back(entries[end - 1]);
+    }
+    this->count = entries.size();
+}
+
+// Visit every entry with lo <= key <= hi in ascending order
+template <class Key, class Ref>
+template <class F>
+void SortedIndex<Key, Ref>::range(const Key& lo, const Key& hi, F visit) const{
+    unsigned long b = this->firstBlock(lo);
+    if(b == this->blocks.size()){
+        return;
+    }
+    const std::vector<Entry>& first = this->blocks[b];
+    auto it = std::lower_bound(first.begin(), first.end(), lo, [](const Entry& e, const Key& k){ return e.key < k; });
+    for(unsigned long i = it - first.begin(); b < this->blocks.size(); b++, i = 0){
+        const std::vector<Entry>& block = this->blocks[b];
+        for(; i < block.size(); i++){
+            if(hi < block[i].key){
+                return;
+            }
+            visit(block[i].key, block[i].ref);
+        }
+    }
+}
+
+// Visit the k entries with the largest keys, largest first
+template <class Key, class Ref>
+template <class F>
+void SortedIndex<Key, Ref>::top(unsigned long k, F visit) const{
+    for(unsigned long b = this->blocks.size(); b-- > 0 && k > 0;){
+        const std::vector<Entry>& block = this->blocks[b];
+        for(unsigned long i = block.size(); i-- > 0 && k > 0; k--){
+            visit(block[i].key, block[i].ref);
+        }
+    }
+}
+
+/*************************************************
+ * IndexedStudentMap class contents by section:
+ * 1. IndexedStudentMap class private data members
+ * 2. IndexedStudentMap private helper prototypes
+ * 3. IndexedStudentMap constructor prototype
+ * 4. IndexedStudentMap class method prototypes
+ *************************************************/
+template <class Pool = HeapPool, class Range = ModuloRange>
+class IndexedStudentMap {
+public:
+    using Table = HashMap<string, Student, StringHash, StringEq, Pool, Range>;
+
+private:
+    // 1.
+    Table table;                                            // owns the records
+    SortedIndex<unsigned int, const Student *> byAge;
+    SortedIndex<double, const Student *> byGPA;
+    bool ageIndexed;
+    bool gpaIndexed;
+
+    // 2.
+    void index(const Student *s);                           // add a record to every index that is on
+    void unindex(const Student *s);                         // remove a record from every index that is on
+
+public:
+    // 3.
+    explicit IndexedStudentMap(unsigned long size, bool indexAge = true, bool indexGPA = true);
+
+    // 4.
+    const Table& getTable() const;
+    unsigned long getCount() const;
+    unsigned long indexMemory() const;                      // bytes held by the indexes
+    const Student *find(std::string_view id) const;
+    void put(Student s);                                    // insert, or replace the record with the same ID
+    bool update(std::string_view id, unsigned int age, double gpa); // false if id isn't in the table
+    template <class L>
+    void bulkLoad(L load);                                  // load(table) straight into the table, then rebuild
+    void rebuildIndexes();                                  // sort every index from the table in one go
+    template <class F>
+    void ageRange(unsigned int lo, unsigned int hi, F visit) const;   // visit(student) for lo <= age <= hi
+    template <class F>
+    void gpaRange(double lo, double hi, F visit) const;     // visit(student) for lo <= GPA <= hi
+    template <class F>
+    void topGPA(unsigned long k, F visit) const;            // visit(student) for the k highest GPAs, highest first
+    template <class F>
+    void oldest(unsigned long k, F visit) const;            // visit(student) for the k oldest, oldest first
+};
+
+// Empty table with the chosen indexes
+template <class Pool, class Range>
+IndexedStudentMap<Pool, Range>::IndexedStudentMap(unsigned long size, bool indexAge, bool indexGPA) : table(size){
+    this->ageIndexed = indexAge;
+    this->gpaIndexed = indexGPA;
+}
+
+// Add a record to every index that is on
+template <class Pool, class Range>
+void IndexedStudentMap<Pool, Range>::index(const Student *s){
+    if(this->ageIndexed){
+        this->byAge.insert(s->getAge(), s);
+    }
+    if(this->gpaIndexed){
+        this->byGPA.insert(s->getGPA(), s);
+    }
+}
+
+// Remove a record from every index that is on (call before changing its age or GPA)
+template <class Pool, class Range>
+void IndexedStudentMap<Pool, Range>::unindex(const Student *s){
+    if(this->ageIndexed){
+        this->byAge.erase(s->getAge(), s);
+    }
+    if(this->gpaIndexed){
+        this->byGPA.erase(s->getGPA(), s);
+    }
+}
+
+// The table the records live in
+template <class Pool, class Range>
+const typename IndexedStudentMap<Pool, Range>::Table& IndexedStudentMap<Pool, Range>::getTable() const{
+    return this->table;
+}
+
+// Number of students
+template <class Pool, class Range>
+unsigned long IndexedStudentMap<Pool, Range>::getCount() const{
+    return this->table.getCount();
+}
+
+// Bytes held by the indexes
+template <class Pool, class Range>
+unsigned long IndexedStudentMap<Pool, Range>::indexMemory() const{
+    return this->byAge.memoryUsage() + this->byGPA.memoryUsage();
+}
+
+// The student with this ID, or nullptr
+template <class Pool, class Range>
+const Student *IndexedStudentMap<Pool, Range>::find(std::string_view id) const{
+    return this->table.find(id);
+}
+
+// Insert a student, replacing the record with the same ID if there is one
+template <class Pool, class Range>
+void IndexedStudentMap<Pool, Range>::put(Student s){
+    Student *existing = this->table.find(s.getID());
+    if(existing != nullptr){
+        this->unindex(existing);
+        *existing = std::move(s);
+        this->index(existing);
+        return;
+    }
+    string id = s.getID();
+    this->index(&this->table.put(std::move(id), std::move(s)));
+}
+
+// Change a student's age and GPA, moving the record in both indexes
+template <class Pool, class Range>
+bool IndexedStudentMap<Pool, Range>::update(std::string_view id, unsigned int age, double gpa){
+    Student *s = this->table.find(id);
+    if(s == nullptr){
+        return false;
+    }
+    this->unindex(s);
+    s->setAge(age);
+    s->setGPA(gpa);
+    this->index(s);
+    return true;
+}
+
+// Let load(table) fill the table directly (e.g. importInto), then rebuild the indexes once (load shouldn't repeat IDs)
+template <class Pool, class Range>
+template <class L>
+void IndexedStudentMap<Pool, Range>::bulkLoad(L load){
+    load(this->table);
+    this->rebuildIndexes();
+}
+
+// Rebuild every index that is on from the table, one sort each
+template <class Pool, class Range>
+void IndexedStudentMap<Pool, Range>::rebuildIndexes(){
+    if(this->ageIndexed){
+        std::vector<typename SortedIndex<unsigned int, const Student *>::Entry> ages;
+        ages.reserve(this->table.getCount());
+        this->table.forEach([&ages](const string&, const Student& s){ ages.push_back({s.getAge(), &s}); });
+        this->byAge.build(ages);
+    }
+    if(this->gpaIndexed){
+        std::vector<typename SortedIndex<double, const Student *>::Entry> gpas;
+        gpas.reserve(this->table.getCount());
+        this->table.forEach([&gpas](const string&, const Student& s){ gpas.push_back({s.getGPA(), &s}); });
+        this->byGPA.build(gpas);
+    }
+}
+
+// Visit every student aged lo to hi, youngest first (in table order without the age index)
+template <class Pool, class Range>
+template <class F>
+void IndexedStudentMap<Pool, Range>::ageRange(unsigned int lo, unsigned int hi, F visit) const{
+    if(this->ageIndexed){
+        this->byAge.range(lo, hi, [&visit](unsigned int, const Student *s){ visit(*s); });
+        return;
+    }
+    this->table.forEach([&](const string&, const Student& s){
+        if(s.getAge() >= lo && s.getAge() <= hi){
+            visit(s);
+        }
+    });
+}
+
+// Visit every student with a GPA from lo to hi, lowest first (in table order without the GPA index)
+template <class Pool, class Range>
+template <class F>
+void IndexedStudentMap<Pool, Range>::gpaRange(double lo, double hi, F visit) const{
+    if(this->gpaIndexed){
+        this->byGPA.range(lo, hi, [&visit](double, const Student *s){ visit(*s); });
+        return;
+    }
+    this->table.forEach([&](const string&, const Student& s){
+        if(s.getGPA() >= lo && s.getGPA() <= hi){
+            visit(s);
+        }
+    });
+}
+
+// Visit the k students with the highest GPAs, highest first
+template <class Pool, class Range>
+template <class F>
+void IndexedStudentMap<Pool, Range>::topGPA(unsigned long k, F visit) const{
+    if(this->gpaIndexed){
+        this->byGPA.top(k, [&visit](double, const Student *s){ visit(*s); });
+        return;
+    }
+    std::vector<const Student *> all;                       // no index: gather every record and sort the best k
+    this->table.forEach([&all](const string&, const Student& s){ all.push_back(&s); });
+    k = std::min<unsigned long>(k, all.size());
+    std::partial_sort(all.begin(), all.begin() + k, all.end(),
+                      [](const Student *a, const Student *b){ return a->getGPA() > b->getGPA(); });
+    for(unsigned long i = 0; i < k; i++){
+        visit(*all[i]);
+    }
+}
+
+// Visit the k oldest students, oldest first
+template <class Pool, class Range>
+template <class F>
+void IndexedStudentMap<Pool, Range>::oldest(unsigned long k, F visit) const{
+    if(this->ageIndexed){
+        this->byAge.top(k, [&visit](unsigned int, const Student *s){ visit(*s); });
+        return;
+    }
+    std::vector<const Student *> all;
+    this->table.forEach([&all](const string&, const Student& s){ all.push_back(&s); });
+    k = std::min<unsigned long>(k, all.size());
+    std::partial_sort(all.begin(), all.begin() + k, all.end(),
+                      [](const Student *a, const Student *b){ return a->getAge() > b->getAge(); });
+    for(unsigned long i = 0; i < k; i++){
+        visit(*all[i]);
+    }
+}
+
+#endif //STUDENTINDEX_H